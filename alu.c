@@ -0,0 +1,38 @@
+#include <pthread.h>
+
+#include "./alu.h"
+
+#ifdef CPU_ALU_TABLE
+
+word alu_adc_table[ALU_MODES][2][0x100][0x100];
+#ifndef CPU_VARIANT_2A03
+word alu_sbc_table[2][0x100][0x100];
+#endif // CPU_VARIANT_2A03
+
+// Shared by every board, read-only once built
+static pthread_once_t built = PTHREAD_ONCE_INIT;
+
+static void alu_build(void) {
+    for (unsigned carry = 0; carry < 2; carry++) {
+        for (unsigned a = 0; a < 0x100; a++) {
+            for (unsigned m = 0; m < 0x100; m++) {
+                alu_adc_table[0][carry][a][m] = alu_adc_arith(a, m, carry, false);
+#ifndef CPU_VARIANT_2A03
+                alu_adc_table[1][carry][a][m] = alu_adc_arith(a, m, carry, true);
+                alu_sbc_table[carry][a][m] = alu_sbc_arith(a, m, carry, true);
+#endif // CPU_VARIANT_2A03
+            }
+        }
+    }
+}
+
+void alu_init(void) {
+    pthread_once(&built, alu_build);
+}
+
+#else
+
+void alu_init(void) {
+}
+
+#endif // CPU_ALU_TABLE
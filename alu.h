@@ -0,0 +1,151 @@
+#ifndef ALU_H_
+#define ALU_H_
+
+#include "./arch.h"
+#include "./cpu.h"
+
+// ADC, SBC and the compares, binary and decimal mode. Results are packed as
+// result | (N V Z C flags << 8). make ALU=table looks them up in tables built
+// at startup from the arithmetic below, make ALU=arith (the default) computes
+// them. The 2A03 has no decimal mode, the 65C02 sets N and Z from the
+// adjusted result.
+
+#ifdef CPU_VARIANT_2A03
+// binary only
+#define ALU_MODES 1
+#else
+// binary and decimal
+#define ALU_MODES 2
+#endif // CPU_VARIANT_2A03
+
+#define ALU_FLAGS (FLAG_N | FLAG_V | FLAG_Z | FLAG_C)
+
+static inline word alu_pack(unsigned result, bool n, bool v, bool z, bool carry) {
+    return (result & 0xFF) | (((n ? FLAG_N : 0) | (v ? FLAG_V : 0)
+        | (z ? FLAG_Z : 0) | (carry ? FLAG_C : 0)) << 8);
+}
+
+static inline word alu_adc_arith(byte a, byte m, byte carry, bool decimal) {
+    unsigned sum = a + m + carry;
+    if (!decimal) {
+        return alu_pack(sum, sum & 0x80, ~(a ^ m) & (a ^ sum) & 0x80,
+                        (sum & 0xFF) == 0, sum > 0xFF);
+    }
+
+    // NMOS: N and V come from the sum before the high digit is adjusted, Z
+    // from the binary sum
+    unsigned lo = (a & 0x0F) + (m & 0x0F) + carry;
+    if (lo >= 0x0A) {
+        lo = ((lo + 0x06) & 0x0F) + 0x10;
+    }
+    unsigned bcd = (a & 0xF0) + (m & 0xF0) + lo;
+    bool n = bcd & 0x80;
+    bool v = ~(a ^ m) & (a ^ bcd) & 0x80;
+    bool z = (sum & 0xFF) == 0;
+    if (bcd >= 0xA0) {
+        bcd += 0x60;
+    }
+#ifdef CPU_VARIANT_65C02
+    // 65C02: N and Z from the adjusted result
+    n = bcd & 0x80;
+    z = (bcd & 0xFF) == 0;
+#endif // CPU_VARIANT_65C02
+    return alu_pack(bcd, n, v, z, bcd > 0xFF);
+}
+
+static inline word alu_sbc_arith(byte a, byte m, byte carry, bool decimal) {
+    // NMOS: flags always come from the binary difference
+    int borrow = !carry;
+    int diff = a - m - borrow;
+    word binary = alu_pack(diff, diff & 0x80, (a ^ m) & (a ^ diff) & 0x80,
+                           (diff & 0xFF) == 0, diff >= 0);
+    if (!decimal) {
+        return binary;
+    }
+
+    int lo = (a & 0x0F) - (m & 0x0F) - borrow;
+#ifdef CPU_VARIANT_65C02
+    // adjusts the binary difference, N and Z from the result
+    int bcd = diff;
+    if (bcd < 0) {
+        bcd -= 0x60;
+    }
+    if (lo < 0) {
+        bcd -= 0x06;
+    }
+    return alu_pack(bcd, bcd & 0x80, (a ^ m) & (a ^ diff) & 0x80,
+                    (bcd & 0xFF) == 0, diff >= 0);
+#else
+    if (lo < 0) {
+        lo = ((lo - 0x06) & 0x0F) - 0x10;
+    }
+    int bcd = (a & 0xF0) - (m & 0xF0) + lo;
+    if (bcd < 0) {
+        bcd -= 0x60;
+    }
+    return (binary & 0xFF00) | (bcd & 0xFF);
+#endif // CPU_VARIANT_65C02
+}
+
+#ifdef CPU_ALU_TABLE
+
+// [decimal][carry][A][M]
+extern word alu_adc_table[ALU_MODES][2][0x100][0x100];
+#ifndef CPU_VARIANT_2A03
+// [carry][A][M], decimal only, binary SBC is ADC of ~M
+extern word alu_sbc_table[2][0x100][0x100];
+#endif // CPU_VARIANT_2A03
+
+#endif // CPU_ALU_TABLE
+
+// Builds the tables, once, for make ALU=table
+void alu_init(void);
+
+// Decimal mode is on, a constant false on the 2A03 so the BCD paths drop out
+static inline bool alu_decimal(const cpu *c) {
+#ifdef CPU_VARIANT_2A03
+    UNUSED(c);
+    return false;
+#else
+    return c->P & FLAG_D;
+#endif // CPU_VARIANT_2A03
+}
+
+static inline void alu_adc(cpu *c, byte m) {
+    bool decimal = alu_decimal(c);
+#ifdef CPU_ALU_TABLE
+    word r = alu_adc_table[decimal][cpu_get_flag(c, FLAG_C)][c->A][m];
+#else
+    word r = alu_adc_arith(c->A, m, cpu_get_flag(c, FLAG_C), decimal);
+#endif // CPU_ALU_TABLE
+    cpu_set_flags(c, ALU_FLAGS, r >> 8);
+    c->A = r;
+}
+
+static inline void alu_sbc(cpu *c, byte m) {
+    bool decimal = alu_decimal(c);
+#if defined(CPU_ALU_TABLE) && defined(CPU_VARIANT_2A03)
+    UNUSED(decimal);
+    word r = alu_adc_table[0][cpu_get_flag(c, FLAG_C)][c->A][(byte)~m];
+#elif defined(CPU_ALU_TABLE)
+    word r = decimal ? alu_sbc_table[cpu_get_flag(c, FLAG_C)][c->A][m]
+                     : alu_adc_table[0][cpu_get_flag(c, FLAG_C)][c->A][(byte)~m];
+#else
+    word r = alu_sbc_arith(c->A, m, cpu_get_flag(c, FLAG_C), decimal);
+#endif // CPU_ALU_TABLE
+    cpu_set_flags(c, ALU_FLAGS, r >> 8);
+    c->A = r;
+}
+
+// CMP, CPX, CPY: a binary subtraction that only keeps N, Z and C
+static inline void alu_cmp(cpu *c, byte reg, byte m) {
+#ifdef CPU_ALU_TABLE
+    word r = alu_adc_table[0][1][reg][(byte)~m];
+    cpu_set_flags(c, FLAG_N | FLAG_Z | FLAG_C, r >> 8);
+#else
+    cpu_set_nz(c, reg - m);
+    cpu_set_flag(c, FLAG_C, reg >= m);
+#endif // CPU_ALU_TABLE
+}
+
+#endif // !ALU_H_
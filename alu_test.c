@@ -0,0 +1,158 @@
+#include <stdio.h>
+
+#include "./alu.h"
+
+// Exhaustive ALU check, run by make test: ADC, SBC and the compares for
+// every (carry, A, M), in binary and (but on the 2A03) decimal mode, first
+// straight from alu_adc_arith() and alu_sbc_arith(), then through alu_adc(),
+// alu_sbc() and alu_cmp() on a cpu, which look the tables up with make
+// ALU=table. Both are held against the reference below.
+
+// Written from the published NMOS and 65C02 decimal mode sequences, with V
+// from the signed sum and not from the carries as alu.h does
+typedef struct Result {
+    byte a;
+    bool n, v, z, c;
+} Result;
+
+static bool signed_overflow(int sum) {
+    return sum < -128 || sum > 127;
+}
+
+static Result ref_adc(int a, int m, int carry, bool decimal) {
+    int sum = a + m + carry;
+    Result r = {sum & 0xFF, sum & 0x80, signed_overflow((int8_t)a + (int8_t)m + carry),
+                (sum & 0xFF) == 0, sum > 0xFF};
+    if (!decimal) {
+        return r;
+    }
+    int lo = (a & 0x0F) + (m & 0x0F) + carry;
+    if (lo >= 0x0A) {
+        lo = ((lo + 0x06) & 0x0F) + 0x10;
+    }
+    // N and V from the high digits added as signed values, Z stays binary
+    int high = (int8_t)(a & 0xF0) + (int8_t)(m & 0xF0) + lo;
+    r.n = high & 0x80;
+    r.v = signed_overflow(high);
+    int bcd = (a & 0xF0) + (m & 0xF0) + lo;
+    if (bcd >= 0xA0) {
+        bcd += 0x60;
+    }
+    r.a = bcd & 0xFF;
+    r.c = bcd >= 0x100;
+#ifdef CPU_VARIANT_65C02
+    r.n = r.a & 0x80;
+    r.z = r.a == 0;
+#endif // CPU_VARIANT_65C02
+    return r;
+}
+
+static Result ref_sbc(int a, int m, int carry, bool decimal) {
+    int diff = a - m - (1 - carry);
+    Result r = {diff & 0xFF, diff & 0x80, signed_overflow((int8_t)a - (int8_t)m - (1 - carry)),
+                (diff & 0xFF) == 0, diff >= 0};
+    if (!decimal) {
+        return r;
+    }
+    int lo = (a & 0x0F) - (m & 0x0F) + carry - 1;
+#ifdef CPU_VARIANT_65C02
+    int bcd = diff;
+    if (bcd < 0) {
+        bcd -= 0x60;
+    }
+    if (lo < 0) {
+        bcd -= 0x06;
+    }
+    r.n = bcd & 0x80;
+    r.z = (bcd & 0xFF) == 0;
+#else
+    // every flag from the binary difference
+    if (lo < 0) {
+        lo = ((lo - 0x06) & 0x0F) - 0x10;
+    }
+    int bcd = (a & 0xF0) - (m & 0xF0) + lo;
+    if (bcd < 0) {
+        bcd -= 0x60;
+    }
+#endif // CPU_VARIANT_65C02
+    r.a = bcd & 0xFF;
+    return r;
+}
+
+static Result ref_cmp(int reg, int m) {
+    return (Result){reg, (reg - m) & 0x80, false, reg == m, reg >= m};
+}
+
+static byte flags_of(const Result *r) {
+    return (r->n ? FLAG_N : 0) | (r->v ? FLAG_V : 0) | (r->z ? FLAG_Z : 0) | (r->c ? FLAG_C : 0);
+}
+
+static long failures;
+
+static void expect(const char *what, int decimal, int carry, int a, int m, byte got_a, byte got_p,
+                   byte want_a, byte want_p) {
+    if (got_a == want_a && got_p == want_p) {
+        return;
+    }
+    if (failures++ < 10) {
+        printf("%s %s C=%d A=$%02X M=$%02X: got A=$%02X P=$%02X, expected A=$%02X P=$%02X\n",
+               what, decimal ? "decimal" : "binary", carry, a, m, got_a, got_p, want_a, want_p);
+    }
+}
+
+int main(void) {
+    alu_init();
+    static cpu c;
+    long checked = 0;
+
+    for (int decimal = 0; decimal < ALU_MODES; decimal++) {
+        for (int carry = 0; carry < 2; carry++) {
+            for (int a = 0; a < 0x100; a++) {
+                for (int m = 0; m < 0x100; m++) {
+                    Result adc = ref_adc(a, m, carry, decimal);
+                    Result sbc = ref_sbc(a, m, carry, decimal);
+                    Result cmp = ref_cmp(a, m);
+
+                    word r = alu_adc_arith(a, m, carry, decimal);
+                    expect("adc_arith", decimal, carry, a, m, r, r >> 8, adc.a, flags_of(&adc));
+                    r = alu_sbc_arith(a, m, carry, decimal);
+                    expect("sbc_arith", decimal, carry, a, m, r, r >> 8, sbc.a, flags_of(&sbc));
+
+                    // through the cpu, the flags outside the ALU's stay put
+                    // and V is left alone by the compares
+                    byte base = FLAG_U | FLAG_I | (decimal ? FLAG_D : 0) | (carry ? FLAG_C : 0);
+                    for (int v = 0; v < 2; v++) {
+                        byte before = base | (v ? FLAG_V | FLAG_N : FLAG_Z);
+                        byte kept = before & ~ALU_FLAGS;
+
+                        cpu_set_P(&c, before);
+                        c.A = a;
+                        alu_adc(&c, m);
+                        expect("ADC", decimal, carry, a, m, c.A, cpu_get_P(&c), adc.a, kept | flags_of(&adc));
+
+                        cpu_set_P(&c, before);
+                        c.A = a;
+                        alu_sbc(&c, m);
+                        expect("SBC", decimal, carry, a, m, c.A, cpu_get_P(&c), sbc.a, kept | flags_of(&sbc));
+
+                        cpu_set_P(&c, before);
+                        c.A = a;
+                        alu_cmp(&c, a, m);
+                        expect("CMP", decimal, carry, a, m, c.A, cpu_get_P(&c), a,
+                               (before & ~(FLAG_N | FLAG_Z | FLAG_C)) | flags_of(&cmp));
+                    }
+                    checked++;
+                }
+            }
+        }
+    }
+
+    printf("%s, %s: %ld inputs, %ld mismatches\n", CPU_VARIANT,
+#ifdef CPU_ALU_TABLE
+           "ALU=table",
+#else
+           "ALU=arith",
+#endif // CPU_ALU_TABLE
+           checked, failures);
+    return failures != 0;
+}
@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "./board.h"
+
+uint32_t aot_hash(Board *b, const AotEntry *entries, unsigned count) {
+    uint32_t hash = 2166136261u;
+    for (unsigned i = 0; i < count; i++) {
+        for (word j = 0; j < entries[i].length; j++) {
+            hash ^= board_read(b, (word)(entries[i].pc + j));
+            hash *= 16777619u;
+        }
+    }
+    return hash;
+}
+
+#ifdef CPU_AOT
+
+Aot *aot_init(Board *b) {
+    Aot *aot = (Aot *)calloc(1, sizeof(Aot));
+    if (aot == NULL) {
+        return NULL;
+    }
+    if (!aot_load(aot, b)) {
+        free(aot);
+        return NULL;
+    }
+    return aot;
+}
+
+bool aot_load(Aot *aot, Board *b) {
+    if (aot_hash(b, aot_entries, aot_entry_count) != aot_checksum) {
+        fprintf(stderr, "recompiled code does not match the loaded ROM\n");
+        return false;
+    }
+    for (unsigned i = 0; i < aot_entry_count; i++) {
+        aot->map[aot_entries[i].pc] = aot_entries[i].fn;
+    }
+    aot->loaded = true;
+    return true;
+}
+
+void aot_invalidate_page(Aot *aot, byte page) {
+    // blocks chain to each other inside a function, drop whole functions
+    for (unsigned i = 0; i < aot_entry_count; i++) {
+        const AotEntry *e = &aot_entries[i];
+        byte first = e->pc >> MEM_PAGE_SHIFT;
+        byte last = (word)(e->pc + e->length - 1) >> MEM_PAGE_SHIFT;
+        if (first != page && last != page) {
+            continue;
+        }
+        for (unsigned j = 0; j < aot_entry_count; j++) {
+            if (aot_entries[j].fn == e->fn) {
+                aot->map[aot_entries[j].pc] = NULL;
+            }
+        }
+    }
+}
+
+#else
+
+Aot *aot_init(Board *b) {
+    UNUSED(b);
+    fprintf(stderr, "no recompiled ROM linked in, see make AOT=\n");
+    return NULL;
+}
+
+bool aot_load(Aot *aot, Board *b) {
+    UNUSED(aot);
+    UNUSED(b);
+    return false;
+}
+
+void aot_invalidate_page(Aot *aot, byte page) {
+    UNUSED(aot);
+    UNUSED(page);
+}
+
+#endif // CPU_AOT
+
+void aot_shutdown(Aot *aot) {
+    free(aot);
+}
+
+void aot_reset(Aot *aot) {
+    memset(aot->map, 0, sizeof(aot->map));
+    aot->steps = 0;
+    aot->fallbacks = 0;
+    aot->ops = 0;
+    aot->loaded = false;
+}
+
+byte aot_step(cpu *c) {
+    Aot *aot = c->bc->aot;
+
+    if (c->nmi == TIED_LOW || c->irq == TIED_LOW) {
+        byte cycles = cpu_interrupt(c);
+        if (cycles != 0) {
+            return cycles;
+        }
+    }
+
+    aot_fn_t fn = aot->map[c->PC];
+    if (fn == NULL) {
+        aot->fallbacks++;
+        aot->ops++;
+        return cpu_step(c);
+    }
+    aot->steps++;
+    return fn(c);
+}
@@ -0,0 +1,57 @@
+#ifndef AOT_H_
+#define AOT_H_
+
+#include "./arch.h"
+#include "./cpu.h"
+
+// Recompiled code stops chaining blocks once a step has run this many
+// cycles, a block of at most AOT_BLOCK_MAX_OPS still fits a step's byte
+#define AOT_STEP_CYCLES 96
+#define AOT_BLOCK_MAX_OPS 16
+
+typedef struct Board Board;
+
+// A recompiled function, entered at the block c->PC points to
+typedef byte (*aot_fn_t)(cpu *c);
+
+// One recompiled block: where it starts, how many ROM bytes it was
+// translated from and the function holding it
+typedef struct AotEntry {
+    word pc;
+    word length;
+    aot_fn_t fn;
+} AotEntry;
+
+typedef struct Aot {
+    aot_fn_t map[0x10000];  // block start -> function, NULL runs cpu_step()
+    uint64_t steps;         // steps run in recompiled code
+    uint64_t fallbacks;     // instructions left to the interpreter
+    uint64_t ops;           // instructions run, fallbacks included
+    bool loaded;            // map filled by aot_load()
+} Aot;
+
+// Emitted by the recompiler (see recomp.c), linked in with make AOT=file.c
+extern const AotEntry aot_entries[];
+extern const unsigned aot_entry_count;
+extern const uint32_t aot_checksum;
+
+// FNV-1a over the bytes every entry was translated from, as mapped on b
+uint32_t aot_hash(Board *b, const AotEntry *entries, unsigned count);
+
+// NULL if no recompiled ROM is linked in or it does not match b's memory
+Aot *aot_init(Board *b);
+void aot_shutdown(Aot *aot);
+// Fills the map from the recompiled ROM, false if it does not match b's
+// memory
+bool aot_load(Aot *aot, Board *b);
+// Empties the map and clears the counters, aot_load() fills it again
+void aot_reset(Aot *aot);
+
+// Disables every function holding code from the given 256-byte page
+void aot_invalidate_page(Aot *aot, byte page);
+
+// Runs recompiled code from c->PC, or one instruction on the interpreter
+// where there is none (RAM, indirect jump targets, unreached code)
+byte aot_step(cpu *c);
+
+#endif // !AOT_H_
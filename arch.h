@@ -25,6 +25,11 @@ typedef word addr;
 
 #define ROM_BASE        0x8000
 
+// Memory map granularity: 256 pages of 256 bytes
+#define MEM_PAGE_SHIFT  8
+#define MEM_PAGE_SIZE   (1 << MEM_PAGE_SHIFT)
+#define MEM_PAGE_COUNT  0x0100
+
 // Memory sections sizes
 // TODO Separate RAM into different sections
 #define RAM_SIZE         0x8000  // 32KB EEPROM AT28C256 INTERNAL RAM
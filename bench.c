@@ -0,0 +1,71 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "./board.h"
+
+// Instructions executed per core
+#define BENCH_INSTRUCTIONS 50000000L
+
+typedef byte (*step_t)(cpu *c);
+
+static double seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static int bench_core(const char *rom_path, const char *name, step_t step, Engine engine, long instructions) {
+    Board *b = board_init(rom_path);
+    if (b == NULL || !board_set_engine(b, engine)) {
+        board_shutdown(b);
+        return 1;
+    }
+
+    // the block engines and recompiled code run several instructions per
+    // step and count them
+    const uint64_t *ops = NULL;
+    if (engine == ENGINE_BLOCK || engine == ENGINE_DYNAREC) {
+        ops = &b->blocks->ops;
+    } else if (engine == ENGINE_AOT) {
+        ops = &b->aot->ops;
+    } else if (engine == ENGINE_BATCH) {
+        ops = &b->batch_ops;
+    }
+    uint64_t cycles = 0;
+    uint64_t executed = 0;
+    double start = seconds();
+    while (executed < (uint64_t)instructions) {
+        cycles += step(b->c);
+        executed = ops != NULL ? *ops : executed + 1;
+    }
+    double elapsed = seconds() - start;
+
+    printf("%-7s %8.2f M instructions/s %8.2f emulated MHz\n",
+           name, executed / elapsed / 1e6, cycles / elapsed / 1e6);
+    board_shutdown(b);
+    return 0;
+}
+
+// Compares the interpreter cores and engines on the same ROM
+int main(int argc, char **argv) {
+    const char *rom_path = argc > 1 ? argv[1] : "./roms/bench.bin";
+    long instructions = argc > 2 ? atol(argv[2]) : BENCH_INSTRUCTIONS;
+
+    printf("%s, %s\n", rom_path, CPU_VARIANT);
+
+    if (bench_core(rom_path, "table", cpu_step_table, ENGINE_INTERP, instructions) != 0
+        || bench_core(rom_path, "switch", cpu_step_switch, ENGINE_INTERP, instructions) != 0
+        || bench_core(rom_path, "batch", cpu_step_batch, ENGINE_BATCH, instructions) != 0
+        || bench_core(rom_path, "icache", icache_step, ENGINE_ICACHE, instructions) != 0
+        || bench_core(rom_path, "block", block_step, ENGINE_BLOCK, instructions) != 0
+        || bench_core(rom_path, "dynarec", block_step_dynarec, ENGINE_DYNAREC, instructions) != 0
+#ifdef CPU_AOT
+        || bench_core(rom_path, "aot", aot_step, ENGINE_AOT, instructions) != 0
+#endif // CPU_AOT
+        ) {
+        printf("failed to init board\n");
+        return 2;
+    }
+    return 0;
+}
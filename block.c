@@ -0,0 +1,229 @@
+#include <stdlib.h>
+
+#include "./board.h"
+
+BlockCache *block_init(void) {
+    BlockCache *bc = (BlockCache *)calloc(1, sizeof(BlockCache));
+    return bc;
+}
+
+void block_shutdown(BlockCache *bc) {
+    free(bc);
+}
+
+void block_reset(BlockCache *bc) {
+    for (unsigned i = 0; i < BLOCK_LINES; i++) {
+        bc->lines[i].valid = false;
+        bc->lines[i].native = NULL;
+        bc->lines[i].runs = 0;
+    }
+    bc->link = NULL;
+    bc->blocks = 0;
+    bc->ops = 0;
+    bc->misses = 0;
+    bc->fused = 0;
+}
+
+void block_invalidate_page(BlockCache *bc, byte page) {
+    for (unsigned i = 0; i < BLOCK_LINES; i++) {
+        Block *blk = &bc->lines[i];
+        if (blk->valid && (blk->first_page == page || blk->last_page == page)) {
+            blk->valid = false;
+        }
+    }
+}
+
+bool block_ends(byte IR) {
+    const struct code_t *code = &cpu_code_table[IR];
+    return code->addressing_mode == &REL
+        || code->opcode == &JMP || code->opcode == &JSR
+        || code->opcode == &RTS || code->opcode == &RTI
+        || code->opcode == &BRK || code->opcode == &JAM;
+}
+
+bool block_fusable(byte IR) {
+    const struct code_t *code = &cpu_code_table[IR];
+    byte (*op)(cpu *) = code->opcode;
+
+    if (code->addressing_mode == &ACC) {
+        return false;
+    }
+    return op == &LDA || op == &LDX || op == &LDY || op == &AND || op == &ORA
+        || op == &EOR || op == &ADC || op == &SBC || op == &CMP || op == &CPX
+        || op == &CPY || op == &BIT || op == &INX || op == &INY || op == &DEX
+        || op == &DEY || op == &TAX || op == &TAY || op == &TXA || op == &TYA
+        || op == &TXS || op == &CLC || op == &SEC || op == &CLV || op == &CLD
+        || op == &SED || op == &NOP;
+}
+
+// Marks the superinstructions in a decoded block, longest match first. The
+// instructions they span keep their own handlers for the dynarec.
+static void block_fuse(BlockCache *bc, Block *blk) {
+    for (byte i = 0; i < blk->count; ) {
+        byte best = 0;
+        for (byte f = 1; f < cpu_fused_count; f++) {
+            byte n = cpu_fused_table[f].count;
+            if (i + n > blk->count || (best != 0 && n <= cpu_fused_table[best].count)) {
+                continue;
+            }
+            bool match = true;
+            for (byte k = 0; k < n && match; k++) {
+                match = blk->ops[i + k].IR == cpu_fused_table[f].IR[k]
+                    && (k == n - 1 || block_fusable(blk->ops[i + k].IR));
+            }
+            if (match) {
+                best = f;
+            }
+        }
+        if (best == 0) {
+            i++;
+            continue;
+        }
+        blk->ops[i].fused = best;
+        bc->fused++;
+        i += cpu_fused_table[best].count;
+    }
+}
+
+// Translates the block starting at pc, false if its first instruction does
+// not come from plain memory. Blocks end ahead of the breakpoint so runs
+// stop on it, see board_break_pc().
+static bool block_decode(Board *b, word pc, Block *blk) {
+    DecodedOp op;
+    const struct code_t *code = NULL;
+    word start = pc;
+
+    blk->valid = false;
+    blk->count = 0;
+    while (blk->count < BLOCK_MAX_OPS && !(blk->count != 0 && pc == b->break_pc)
+           && icache_decode(b, pc, &op)) {
+        code = &cpu_code_table[op.IR];
+        blk->ops[blk->count++] = (BlockOp){cpu_exec_table[op.IR], op.operand, op.length, op.IR, 0};
+        pc += op.length;
+        if (block_ends(op.IR)) {
+            break;
+        }
+    }
+    if (blk->count == 0) {
+        return false;
+    }
+
+    const BlockOp *last = &blk->ops[blk->count - 1];
+    blk->pc = start;
+    blk->first_page = blk->pc >> MEM_PAGE_SHIFT;
+    blk->last_page = (word)(pc - 1) >> MEM_PAGE_SHIFT;
+
+    blk->next_pc[0] = pc;
+    blk->next_pc[1] = pc;
+    if (code->addressing_mode == &REL) {
+        blk->next_pc[1] = pc + (int8_t)last->operand;
+    } else if (last->IR == 0x4C || last->IR == 0x20) {
+        // JMP abs, JSR abs
+        blk->next_pc[1] = last->operand;
+    }
+    block_fuse(b->blocks, blk);
+    blk->next[0] = NULL;
+    blk->next[1] = NULL;
+    blk->runs = 0;
+    blk->native = NULL;
+    blk->valid = true;
+    return true;
+}
+
+// Kept out of line so the chained path stays small
+__attribute__((noinline)) static Block *block_lookup(cpu *c) {
+    BlockCache *bc = c->bc->blocks;
+    Block *blk = &bc->lines[c->PC & (BLOCK_LINES - 1)];
+
+    if (!blk->valid || blk->pc != c->PC) {
+        bc->misses++;
+        if (!block_decode(c->bc, c->PC, blk)) {
+            return NULL;
+        }
+    }
+    if (bc->link != NULL) {
+        *bc->link = blk;
+    }
+    return blk;
+}
+
+byte block_executed(const Block *blk, word pc, bool stopped) {
+    if (blk->valid && !stopped) {
+        return blk->count;
+    }
+    byte n = 0;
+    for (word at = blk->pc; n < blk->count && at != pc; at += blk->ops[n++].length)
+        ;
+    return n;
+}
+
+// Shared by both engines, jit is a constant NULL for the plain block engine
+static inline byte block_run(cpu *c, Dynarec *jit) {
+    BlockCache *bc = c->bc->blocks;
+
+    if (c->nmi == TIED_LOW || c->irq == TIED_LOW) {
+        byte cycles = cpu_interrupt(c);
+        if (cycles != 0) {
+            bc->link = NULL;
+            return cycles;
+        }
+    }
+
+    Block *blk = bc->link != NULL ? *bc->link : NULL;
+    if (blk == NULL || !blk->valid || blk->pc != c->PC) {
+        blk = block_lookup(c);
+        if (blk == NULL) {
+            // not plain memory, run it one instruction at a time
+            bc->link = NULL;
+            bc->ops++;
+            return cpu_step(c);
+        }
+    }
+
+    byte cycles = 0;
+    if (jit != NULL && blk->native != NULL) {
+        cycles = jit->verify ? dynarec_verify(c, blk) : blk->native(c);
+        bc->ops += block_executed(blk, c->PC, c->bc->stop);
+    } else {
+        // a store into the block itself invalidates it, a fault halts the
+        // CPU and a write breakpoint stops the run, stop right there.
+        // Superinstructions only store in their last instruction.
+        const BlockOp *op = blk->ops;
+        const BlockOp *end = op + blk->count;
+        do {
+            if (op->fused != 0) {
+                const cpu_fused_t *f = &cpu_fused_table[op->fused];
+                cycles += f->run(c, op);
+                op += f->count;
+                continue;
+            }
+            c->IR = op->IR;
+            c->PC += op->length;
+            cycles += op->run(c, op->operand);
+            op++;
+        } while (op < end && blk->valid && !c->halted && !c->bc->stop);
+        bc->ops += op - blk->ops;
+
+        if (jit != NULL && ++blk->runs == DYNAREC_HOT && blk->valid) {
+            dynarec_translate(jit, c->bc, blk);
+        }
+    }
+    bc->blocks++;
+
+    if (c->PC == blk->next_pc[0]) {
+        bc->link = &blk->next[0];
+    } else if (c->PC == blk->next_pc[1]) {
+        bc->link = &blk->next[1];
+    } else {
+        bc->link = NULL;
+    }
+    return cycles;
+}
+
+byte block_step(cpu *c) {
+    return block_run(c, NULL);
+}
+
+byte block_step_dynarec(cpu *c) {
+    return block_run(c, c->bc->dynarec);
+}
@@ -0,0 +1,75 @@
+#ifndef BLOCK_H_
+#define BLOCK_H_
+
+#include "./arch.h"
+#include "./cpu.h"
+
+// Longest block, keeps a whole block's cycles within a byte
+#define BLOCK_MAX_OPS 16
+
+// Direct-mapped, one line per block start address
+#define BLOCK_LINES 0x0400
+
+typedef struct Board Board;
+typedef struct Dynarec Dynarec;
+
+// Native translation of a block, same contract as block_step()
+typedef byte (*native_t)(cpu *c);
+
+// One threaded instruction: its handler and what it needs to run
+typedef struct BlockOp {
+    cpu_exec_t run;
+    word operand;   // raw operand bytes, or the immediate's address
+    byte length;    // opcode + operand bytes
+    byte IR;
+    byte fused;     // cpu_fused_table entry starting here, 0 if none
+} BlockOp;
+
+// Straight-line code ending at a branch, jump, call, return or BRK
+typedef struct Block {
+    word pc;                // tag, address of the first instruction
+    word next_pc[2];        // fall-through and static target (branch/JMP/JSR)
+    struct Block *next[2];  // chained successors, checked before use
+    byte first_page;        // pages the block was decoded from
+    byte last_page;
+    byte count;
+    bool valid;
+    uint32_t runs;          // counted up to DYNAREC_HOT by the dynarec engine
+    native_t native;        // set once translated
+    BlockOp ops[BLOCK_MAX_OPS];
+} Block;
+
+typedef struct BlockCache {
+    Block lines[BLOCK_LINES];
+    Block **link;       // successor slot of the last block run
+    uint64_t blocks;    // blocks run
+    uint64_t ops;       // instructions run
+    uint64_t misses;    // blocks translated
+    uint64_t fused;     // superinstructions decoded into blocks
+} BlockCache;
+
+BlockCache *block_init(void);
+void block_shutdown(BlockCache *bc);
+// Drops every block, with its native code, and clears the counters
+void block_reset(BlockCache *bc);
+
+// Drops every block decoded from the given 256-byte page
+void block_invalidate_page(BlockCache *bc, byte page);
+
+// Runs the block at c->PC and returns its cycles. Interrupt lines are only
+// checked between blocks.
+byte block_step(cpu *c);
+// Same, with hot blocks translated to native code (see dynarec.c)
+byte block_step_dynarec(cpu *c);
+
+// Instructions of blk run when it left at pc, for blocks cut short by a
+// store into them or by the run stopping
+byte block_executed(const Block *blk, word pc, bool stopped);
+
+// Control flow leaves the block after IR, so it is the last one decoded
+bool block_ends(byte IR);
+// IR can run ahead of others in a superinstruction: it only touches
+// registers and flags, so it cannot store into the block or leave it
+bool block_fusable(byte IR);
+
+#endif // !BLOCK_H_
@@ -1,83 +1,541 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "./board.h"
+#include "./pool.h"
 
 
 Board *board_init(const char *rom_path) {
-    Board *b = (Board *)malloc(sizeof(Board));
+    return board_init_rom(board_init_layout(board_default_layout), rom_path);
+}
+
+Board *board_init_rom(Board *b, const char *rom_path) {
+    if (b == NULL) {
+        return NULL;
+    }
+
+    if(rom_path == NULL) {
+        rom_path = "./roms/reset.bin";
+    }
+    if (!board_load_rom(b, rom_path, ROM_BASE, ROM_SIZE, true)) {
+        board_shutdown(b);
+        return NULL;
+    }
+
+    // Reset the CPU
+    cpu_reset(b->c);
+    return b;
+}
+
+Board *board_init_layout(const Region *layout) {
+    // one cache line aligned block for the board, its cpu and its memory
+    Board *b = (Board *)aligned_alloc(_Alignof(Board), sizeof(Board));
     if (b == NULL) {
         perror("failed to allocate memory for board\n");
         return NULL;
     }
+    b->pool = NULL;
+    if (!board_setup(b, layout)) {
+        free(b);
+        return NULL;
+    }
+    return b;
+}
+
+bool board_setup(Board *b, const Region *layout) {
+    // Interpreter until board_set_engine(), nothing decoded yet. Pool slots
+    // come zeroed from the mapping or keep the engines of their last board,
+    // emptied by board_teardown().
+    b->engine = ENGINE_INTERP;
+    b->step = cpu_step;
+    if (b->pool == NULL) {
+        b->icache = NULL;
+        b->blocks = NULL;
+        b->dynarec = NULL;
+        b->aot = NULL;
+    }
+    b->batch_ops = 0;
+    idle_init(&b->idle);
+    sched_init(&b->sched);
+
+    // Everything starts unmapped
+    memset(b->pages, 0, sizeof(b->pages));
+    b->rom_count = 0;
+    if (!board_map(b, layout)) {
+        return false;
+    }
+    memset(b->ram, 0, sizeof(b->ram));
 
     // Initialize clock frequency
-    b->clk.frequency = CLOCK_FREQUENCY;
+    clock_init(&b->clk, CLOCK_FREQUENCY);
 
     // Initialize CPU
-    b->c = cpu_init();
-    if (b->c == NULL) {
+    b->c = &b->core;
+    cpu_init(b->c);
+    b->c->bc = b;
+
+    b->stop = false;
+    b->break_pc = -1;
+    b->break_write = -1;
+    b->fault = 0;
+    b->fault_address = 0;
+
+    pthread_mutex_init(&b->reset_lock, NULL);
+    pthread_cond_init(&b->reset_cond, NULL);
+    b->reset_pending = false;
+
+    return true;
+}
+
+void board_shutdown(Board *b) {
+    if (b == NULL) {
+        return;
+    }
+    board_teardown(b);
+    if (b->pool != NULL) {
+        board_pool_give(b->pool, b);
+    } else {
         free(b);
-        return NULL;
     }
-    b->c->bc = b;
+}
 
-    FILE *file;
-    size_t bytesRead;
+// Empties the engines' caches in place, keeping their memory
+static void board_reset_engines(Board *b) {
+    if (b->icache != NULL) {
+        icache_reset(b->icache);
+    }
+    if (b->blocks != NULL) {
+        block_reset(b->blocks);
+    }
+    if (b->dynarec != NULL) {
+        dynarec_reset(b->dynarec);
+    }
+    if (b->aot != NULL) {
+        aot_reset(b->aot);
+    }
+}
 
-    if(rom_path == NULL) {
-        rom_path = "./roms/reset.bin";
+void board_teardown(Board *b) {
+    for (int i = 0; i < b->rom_count; i++) {
+        munmap(b->roms[i].data, b->roms[i].length);
+    }
+    if (b->pool != NULL) {
+        // the slot's next board gets them empty
+        board_reset_engines(b);
+    } else {
+        board_free_engines(b);
+    }
+    pthread_cond_destroy(&b->reset_cond);
+    pthread_mutex_destroy(&b->reset_lock);
+}
+
+void board_free_engines(Board *b) {
+    icache_shutdown(b->icache);
+    block_shutdown(b->blocks);
+    dynarec_shutdown(b->dynarec);
+    aot_shutdown(b->aot);
+    b->icache = NULL;
+    b->blocks = NULL;
+    b->dynarec = NULL;
+    b->aot = NULL;
+}
+
+bool board_set_engine(Board *b, Engine engine) {
+    if (engine == ENGINE_ICACHE && b->icache == NULL) {
+        b->icache = icache_init();
+        if (b->icache == NULL) {
+            return false;
+        }
+    }
+    if ((engine == ENGINE_BLOCK || engine == ENGINE_DYNAREC) && b->blocks == NULL) {
+        b->blocks = block_init();
+        if (b->blocks == NULL) {
+            return false;
+        }
+    }
+    if (engine == ENGINE_DYNAREC && b->dynarec == NULL) {
+        b->dynarec = dynarec_init();
+        if (b->dynarec == NULL) {
+            return false;
+        }
+    }
+    if (engine == ENGINE_AOT && b->aot == NULL) {
+        b->aot = aot_init(b);
+        if (b->aot == NULL) {
+            return false;
+        }
+    }
+    if (engine == ENGINE_AOT && !b->aot->loaded && !aot_load(b->aot, b)) {
+        // kept from the pool slot's last board
+        return false;
+    }
+
+    switch (engine) {
+    case ENGINE_INTERP:
+        b->step = cpu_step;
+        break;
+    case ENGINE_ICACHE:
+        b->step = icache_step;
+        break;
+    case ENGINE_BLOCK:
+        b->step = block_step;
+        break;
+    case ENGINE_DYNAREC:
+        b->step = block_step_dynarec;
+        break;
+    case ENGINE_AOT:
+        b->step = aot_step;
+        break;
+    case ENGINE_BATCH:
+        b->step = cpu_step_batch;
+        break;
+    default:
+        return false;
+    }
+    b->engine = engine;
+    return true;
+}
+
+// Drops the code every engine decoded from a page
+static void board_invalidate_code(Board *b, byte page) {
+    if (b->icache != NULL) {
+        icache_invalidate_page(b->icache, page);
+    }
+    if (b->blocks != NULL) {
+        block_invalidate_page(b->blocks, page);
     }
-    // Open the binary file in read-binary mode
-    file = fopen(rom_path, "rb");
-    if (file == NULL) {
+    if (b->aot != NULL) {
+        aot_invalidate_page(b->aot, page);
+    }
+    idle_invalidate_page(&b->idle, page);
+}
+
+// Every page table change goes through here so no stale code survives it
+static void board_set_page(Board *b, unsigned page, Page p) {
+    b->pages[page] = p;
+    board_invalidate_code(b, page);
+}
+
+void board_watch_page(Board *b, byte page) {
+    byte *write = b->pages[page].write;
+    if (write == NULL) {
+        return;
+    }
+    for (unsigned i = 0; i < MEM_PAGE_COUNT; i++) {
+        if (b->pages[i].write == write) {
+            b->pages[i].watch = write;
+            b->pages[i].write = NULL;
+        }
+    }
+}
+
+bool board_load_rom(Board *b, const char *rom_path, addr base, uint32_t size, bool mirror) {
+    if (b->rom_count == BOARD_MAX_ROMS) {
+        fprintf(stderr, "too many ROM images\n");
+        return false;
+    }
+    if ((base | size) & (MEM_PAGE_SIZE - 1) || size == 0 || base + size > 0x10000
+        || base < BOARD_DIRECT_END) {
+        fprintf(stderr, "invalid ROM window at $%04X (size $%X)\n", base, size);
+        return false;
+    }
+
+    int fd = open(rom_path, O_RDONLY);
+    if (fd < 0) {
         perror("Error opening file");
-        return NULL;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        perror("Error reading file");
+        close(fd);
+        return false;
+    }
+
+    // Reserve the whole window as zero pages so a short image reads as
+    // padded, then lay the file over its start. Nothing is copied, the
+    // kernel pages the image in on first access.
+    size_t host_page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t image_size = (size_t)st.st_size;
+    size_t length = image_size > size ? image_size : size;
+    length = (length + host_page - 1) & ~(host_page - 1);
+
+    byte *data = mmap(NULL, length, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED) {
+        perror("Error mapping file");
+        close(fd);
+        return false;
+    }
+    if (image_size > 0
+        && mmap(data, image_size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        perror("Error mapping file");
+        munmap(data, length);
+        close(fd);
+        return false;
+    }
+    close(fd);
+
+    RomImage *rom = &b->roms[b->rom_count++];
+    rom->data = data;
+    rom->length = length;
+    rom->size = image_size;
+
+    // A short image repeats every (page rounded) image size, like a ROM chip
+    // with its upper address lines left unconnected, unless asked to pad
+    uint32_t period = size;
+    if (mirror && image_size > 0 && image_size < size) {
+        period = (image_size + MEM_PAGE_SIZE - 1) & ~(uint32_t)(MEM_PAGE_SIZE - 1);
+    }
+    for (uint32_t offset = 0; offset < size; offset += MEM_PAGE_SIZE) {
+        board_set_page(b, (base + offset) >> MEM_PAGE_SHIFT,
+                       (Page){data + offset % period, NULL, NULL, NULL, NULL, NULL});
     }
+    return true;
+}
+
+bool board_map_rom_bank(Board *b, int rom, uint32_t offset, addr base, uint32_t size) {
+    if (rom < 0 || rom >= b->rom_count
+        || (offset | base | size) & (MEM_PAGE_SIZE - 1)
+        || base + size > 0x10000 || base < BOARD_DIRECT_END || offset + size > b->roms[rom].length) {
+        return false;
+    }
+    for (uint32_t i = 0; i < size; i += MEM_PAGE_SIZE) {
+        board_set_page(b, (base + i) >> MEM_PAGE_SHIFT,
+                       (Page){b->roms[rom].data + offset + i, NULL, NULL, NULL, NULL, NULL});
+    }
+    return true;
+}
 
-    // Read the file content into the memory array
-    bytesRead = fread(b->rom, 1, ROM_SIZE, file);
-    if (bytesRead != ROM_SIZE) {
-        if (feof(file)) {
-            printf("Warning: The file is smaller than the expected size.\n");
-        } else if (ferror(file)) {
-            perror("Error reading file");
+static bool board_map_region(Board *b, const Region *r) {
+    uint32_t page = r->start >> MEM_PAGE_SHIFT;
+    uint32_t count = r->size >> MEM_PAGE_SHIFT;
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t offset = r->source + i * MEM_PAGE_SIZE;
+
+        switch (r->kind) {
+        case REGION_RAM:
+            if (offset + MEM_PAGE_SIZE > RAM_SIZE)
+                return false;
+            board_set_page(b, page + i, (Page){b->ram + offset, b->ram + offset, NULL, NULL, NULL, NULL});
+            break;
+        case REGION_MIRROR:
+            if (r->source_size < MEM_PAGE_SIZE)
+                return false;
+            board_set_page(b, page + i, b->pages[(r->source + (i * MEM_PAGE_SIZE) % r->source_size) >> MEM_PAGE_SHIFT]);
+            break;
+        case REGION_DEVICE:
+            board_set_page(b, page + i, (Page){NULL, NULL, r->read, r->write, r->device, NULL});
+            break;
+        default:
+            return false;
         }
-        fclose(file);
-        return NULL;
     }
+    return true;
+}
 
-    // Close the file
-    fclose(file);
+// Zero page and stack are read and written straight from b->ram, see
+// board_read_zp(), so nothing may be mapped there but that RAM
+static bool board_direct_pages(const Board *b) {
+    return b->pages[0].read == b->ram && b->pages[0].write == b->ram
+        && b->pages[1].read == b->ram + MEM_PAGE_SIZE && b->pages[1].write == b->ram + MEM_PAGE_SIZE;
+}
 
-    // Reset the CPU
-    cpu_reset(b->c);
-    return b;
+bool board_map(Board *b, const Region *layout) {
+    for (const Region *r = layout; r->kind != REGION_END; r++) {
+        if ((r->start | r->size | r->source | r->source_size) & (MEM_PAGE_SIZE - 1)
+            || r->size == 0 || r->start + r->size > 0x10000
+            || (r->start < BOARD_DIRECT_END && (r->kind != REGION_RAM || r->source != r->start))
+            || !board_map_region(b, r)) {
+            fprintf(stderr, "invalid memory region at $%04X (size $%X)\n", r->start, r->size);
+            return false;
+        }
+    }
+    if (!board_direct_pages(b)) {
+        fprintf(stderr, "zero page and stack must be RAM at $0000\n");
+        return false;
+    }
+    return true;
 }
 
-void board_shutdown(Board *b) {
-    if (b == NULL) {
+byte board_read_io(Board *b, addr address) {
+    const Page *p = &b->pages[address >> MEM_PAGE_SHIFT];
+    if (p->on_read != NULL)
+        return p->on_read(p->device, address);
+    // open bus
+    return 0xFF;
+}
+
+void board_write_io(Board *b, addr address, byte data) {
+    Page *p = &b->pages[address >> MEM_PAGE_SHIFT];
+    if (address == b->break_write) {
+        b->stop = true;
+    }
+    if (p->watch != NULL) {
+        // first write to RAM holding cached code: unpark the write pointer of
+        // the page and its mirrors and drop what was decoded from them
+        byte *watch = p->watch;
+        watch[address & (MEM_PAGE_SIZE - 1)] = data;
+        for (unsigned i = 0; i < MEM_PAGE_COUNT; i++) {
+            if (b->pages[i].watch == watch) {
+                b->pages[i].write = watch;
+                b->pages[i].watch = NULL;
+                board_invalidate_code(b, i);
+            }
+        }
+        if (b->break_write >> MEM_PAGE_SHIFT == address >> MEM_PAGE_SHIFT) {
+            // keep the write breakpoint's page coming here
+            board_watch_page(b, address >> MEM_PAGE_SHIFT);
+        }
         return;
     }
-    cpu_shutdown(b->c);
-    free(b);
+    if (p->on_write != NULL) {
+        p->on_write(p->device, address, data);
+        return;
+    }
+    // ROM or unmapped
+    board_fault(b, ACCESS_VIOLATION, address);
+}
+
+void board_break_pc(Board *b, int32_t pc) {
+    b->break_pc = pc;
+    if (pc >= 0 && pc <= 0xFFFF) {
+        // blocks are decoded to end ahead of it from now on, drop those
+        // running through it. AOT functions holding it go back to the
+        // interpreter.
+        board_invalidate_code(b, pc >> MEM_PAGE_SHIFT);
+    }
+}
+
+bool board_break_write(Board *b, int32_t address) {
+    if (address > 0xFFFF) {
+        return false;
+    }
+    b->break_write = address;
+    if (address >= 0) {
+        // RAM writes go through board_write_io() while the page is watched,
+        // zero page and stack operands and pushes check in board_write_zp()
+        // and board_write_stack()
+        board_watch_page(b, address >> MEM_PAGE_SHIFT);
+    }
+    return true;
+}
+
+void board_fault(Board *b, byte error, addr address) {
+    b->fault = error;
+    b->fault_address = address;
+    b->c->halted = true;
+    b->stop = true;
+}
+
+uint64_t board_schedule(Board *b, uint64_t cycle, event_t fn, void *data) {
+    return sched_add(&b->sched, cycle, fn, data);
 }
 
-byte board_read(Board *b, addr address) {
-    if(address >= 0 && address < RAM_SIZE)
-        return b->ram[address];
-    return b->rom[address - ROM_BASE];
+bool board_cancel(Board *b, uint64_t id) {
+    return sched_cancel(&b->sched, id);
 }
 
-void board_write(Board *b, addr address, byte data) {
-    if(address >= 0 && address < RAM_SIZE)
-        b->ram[address] = data;
-    throw_exception(ACCESS_VIOLATION);
+// Runs the events due by `now`, including any they schedule in the past
+static void board_dispatch(Board *b, uint64_t now) {
+    Scheduler *s = &b->sched;
+    Event e;
+    s->now = now;
+    while (sched_pop(s, now, &e)) {
+        s->dispatched++;
+        e.fn(b, e.data, e.cycle);
+    }
+}
+
+uint64_t board_run_cycles(Board *b, uint64_t budget) {
+    cpu *c = b->c;
+    Clock *clk = &b->clk;
+    Scheduler *s = &b->sched;
+    uint64_t start = clk->cycles;
+    uint64_t end = start + budget;
+    // the instruction in flight has already executed, only its cycles are owed
+    uint64_t now = start + c->cycles;
+
+    b->stop = false;
+    while (now < end && !c->halted && !b->stop) {
+        if (s->next <= now) {
+            board_dispatch(b, now);
+        }
+        // straight to the next sync, event or the end of the budget
+        uint64_t stop = clk->next_sync < end ? clk->next_sync : end;
+        if (s->next < stop) {
+            stop = s->next;
+        }
+        // idle_skip() stops too when its probe reaches the breakpoint
+        while (now < stop && !b->stop) {
+            word pc = c->PC;
+            s->now = now;
+            if (b->engine == ENGINE_BATCH) {
+                // the whole way to stop in one call, see cpu_run()
+                uint64_t left = stop - now;
+                uint32_t cycles = cpu_run(c, left < UINT32_MAX ? left : UINT32_MAX);
+                now += cycles != 0 ? cycles : cpu_step(c);
+            } else {
+                now += b->step(c);
+            }
+            if (c->PC == b->break_pc) {
+                b->stop = true;
+            }
+            if (c->halted || b->stop) {
+                break;
+            }
+            if (s->next < stop) {
+                // scheduled by a device during the step
+                stop = s->next;
+            }
+            if (c->PC <= pc && b->idle.enabled) {
+                // jumped back, maybe waiting for something
+                now = idle_skip(b, now, stop);
+            }
+        }
+        clock_advance(clk, (now < end ? now : end) - clk->cycles);
+    }
+    if ((c->halted || b->stop) && now < end) {
+        // jammed or stopped, the rest of the budget is not run
+        end = now;
+    }
+    clock_advance(clk, end - clk->cycles);
+
+    c->cycles = now - end;
+    return end - start;
+}
+
+void board_wait_reset(Board *b) {
+    pthread_mutex_lock(&b->reset_lock);
+    while (!b->reset_pending) {
+        pthread_cond_wait(&b->reset_cond, &b->reset_lock);
+    }
+    b->reset_pending = false;
+    pthread_mutex_unlock(&b->reset_lock);
+    b->fault = 0;
+    cpu_reset(b->c);
+}
+
+bool board_poll_reset(Board *b) {
+    pthread_mutex_lock(&b->reset_lock);
+    bool pending = b->reset_pending;
+    b->reset_pending = false;
+    pthread_mutex_unlock(&b->reset_lock);
+    if (pending) {
+        b->fault = 0;
+        cpu_reset(b->c);
+    }
+    return pending;
 }
 
-void __run(Board *b) {
-    do {
-        tick(&b->clk, cpu_clock, b);
-    } while (!cpu_done(b->c));
+void board_signal_reset(Board *b) {
+    pthread_mutex_lock(&b->reset_lock);
+    b->reset_pending = true;
+    pthread_cond_broadcast(&b->reset_cond);
+    pthread_mutex_unlock(&b->reset_lock);
 }
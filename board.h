@@ -1,26 +1,251 @@
 #ifndef BOARD_H_
 #define BOARD_H_
 
+#include <pthread.h>
+#include <stddef.h>
+
 #include "./arch.h"
 #include "./clock.h"
 #include "./cpu.h"
+#include "./icache.h"
+#include "./block.h"
+#include "./dynarec.h"
+#include "./aot.h"
+#include "./idle.h"
+#include "./sched.h"
+
+// Memory-mapped device handlers
+typedef byte (*mmio_read_t)(void *device, addr address);
+typedef void (*mmio_write_t)(void *device, addr address, byte data);
+
+// One 256-byte page of the address space. Plain memory pages point straight
+// at host memory, device pages (NULL pointers) go through the handlers.
+typedef struct Page {
+    byte *read;         // host memory for reads, NULL for devices/unmapped
+    byte *write;        // host memory for writes, NULL if read-only
+    mmio_read_t on_read;
+    mmio_write_t on_write;
+    void *device;
+    byte *watch;        // write pointer parked while cached code lives here
+} Page;
+
+typedef enum {
+    REGION_END,     // terminates a layout
+    REGION_RAM,     // b->ram at offset `source`, read/write
+    REGION_MIRROR,  // repeats the `source_size` bytes mapped at `source`
+    REGION_DEVICE,  // memory-mapped I/O through read/write handlers
+} RegionKind;
+
+// Memory layout description, all addresses and sizes are page aligned
+typedef struct Region {
+    RegionKind kind;
+    uint32_t start;
+    uint32_t size;
+    uint32_t source;
+    uint32_t source_size;
+    mmio_read_t read;
+    mmio_write_t write;
+    void *device;
+} Region;
+
+// Layout used by board_init(), see layout.c
+extern const Region board_default_layout[];
+
+// Maximum number of ROM images mapped on one board
+#define BOARD_MAX_ROMS 8
+
+// A read-only mapping of a ROM image file, never copied
+typedef struct RomImage {
+    byte *data;     // start of the mapping
+    size_t length;  // mapped length, at least the window it was loaded in
+    size_t size;    // image file size
+} RomImage;
+
+// Execution engines, all bit and cycle exact with the interpreter
+typedef enum {
+    ENGINE_INTERP,  // cpu_step(), the reference interpreter
+    ENGINE_ICACHE,  // cpu_step() over predecoded instructions
+    ENGINE_BLOCK,   // chained basic blocks of threaded code
+    ENGINE_DYNAREC, // ENGINE_BLOCK with hot blocks compiled to x86-64
+    ENGINE_AOT,     // ROM recompiled to C ahead of time, see recomp.c
+    ENGINE_BATCH,   // cpu_run(), the interpreter with registers in locals
+} Engine;
 
 typedef struct Board {
     // Clock
     Clock clk;
-    // CPU
+    // CPU, c always points at core
     cpu *c;
+    cpu core;
+
+    // Execution engine, step runs one instruction (one block for
+    // ENGINE_BLOCK) and returns its cycles
+    Engine engine;
+    byte (*step)(cpu *c);
+    ICache *icache;
+    BlockCache *blocks;
+    Dynarec *dynarec;
+    Aot *aot;
+    uint64_t batch_ops;     // instructions run by ENGINE_BATCH
+
+    // Spin loop detection, see board_run_cycles()
+    Idle idle;
+    // Timed device and interrupt events
+    Scheduler sched;
+
+    // Run stops: board_run_cycles() returns at the next instruction boundary
+    // once `stop` is set, see board_break_pc(), board_break_write() and
+    // board_fault()
+    bool stop;
+    int32_t break_pc;       // -1 if none
+    int32_t break_write;    // -1 if none
+    byte fault;             // 0, or the fault code the CPU halted on
+    addr fault_address;
+
+    // Reset requests for a halted CPU, see board_wait_reset()
+    pthread_mutex_t reset_lock;
+    pthread_cond_t reset_cond;
+    bool reset_pending;
+
+    // Address space
+    Page pages[MEM_PAGE_COUNT];
+
+    // ROM images, mapped in place
+    RomImage roms[BOARD_MAX_ROMS];
+    int rom_count;
 
     byte ram[RAM_SIZE];
-    byte rom[ROM_SIZE];
-} Board; 
 
+    // Pool the board came from, NULL if it was allocated on its own
+    struct BoardPool *pool;
+    struct Board *pool_next;    // next free slot while handed back
+} Board;
+
+// Default board with rom_path mapped at ROM_BASE, reset and ready to run
 Board *board_init(const char *rom_path);
+// Board with only `layout` mapped, load ROMs then cpu_reset() before running
+Board *board_init_layout(const Region *layout);
+// Frees b, or hands it back to its pool, see pool.h
 void board_shutdown(Board *b);
 
-byte board_read(Board *b, addr address);
-void board_write(Board *b, addr address, byte data);
+// board_init_layout() and board_shutdown() in place, for boards in memory
+// they do not own. board_setup() leaves nothing to tear down on failure.
+bool board_setup(Board *b, const Region *layout);
+void board_teardown(Board *b);
+// Frees the engines, board_teardown() keeps them for pooled boards, whose
+// slots reuse them until board_pool_shutdown()
+void board_free_engines(Board *b);
+// Maps rom_path (reset.bin if NULL) as board_init() does and resets the
+// CPU, shuts b down on failure. NULL for a NULL board.
+Board *board_init_rom(Board *b, const char *rom_path);
+
+// Maps a ROM image file read-only over [base, base + size). Images smaller
+// than the window are mirrored across it, or zero padded if !mirror. Larger
+// (banked) images map their first `size` bytes, see board_map_rom_bank().
+bool board_load_rom(Board *b, const char *rom_path, addr base, uint32_t size, bool mirror);
+// Maps `size` bytes of loaded image `rom` starting at `offset` over `base`
+bool board_map_rom_bank(Board *b, int rom, uint32_t offset, addr base, uint32_t size);
+
+// Zero page and stack, always b->ram and never remapped
+#define BOARD_DIRECT_END (STACK_BASE + MEM_PAGE_SIZE)
+
+// Maps a REGION_END terminated layout over the current one. Zero page and
+// the stack must end up as internal RAM at $0000, one to one.
+bool board_map(Board *b, const Region *layout);
+
+bool board_set_engine(Board *b, Engine engine);
+
+// Routes writes to a RAM page (and its mirrors) through board_write_io()
+// until the next one, which invalidates the code cached from it
+void board_watch_page(Board *b, byte page);
+
+byte board_read_io(Board *b, addr address);
+void board_write_io(Board *b, addr address, byte data);
+
+static inline byte board_read(Board *b, addr address) {
+    const Page *p = &b->pages[address >> MEM_PAGE_SHIFT];
+    if (p->read != NULL)
+        return p->read[address & (MEM_PAGE_SIZE - 1)];
+    return board_read_io(b, address);
+}
+
+static inline void board_write(Board *b, addr address, byte data) {
+    const Page *p = &b->pages[address >> MEM_PAGE_SHIFT];
+    if (p->write != NULL)
+        p->write[address & (MEM_PAGE_SIZE - 1)] = data;
+    else
+        board_write_io(b, address, data);
+}
+
+// Page holds zero page or stack memory, directly or as a mirror. Code is
+// never cached from these, so writes to them have no watch to trip.
+static inline bool board_page_direct(const Board *b, byte page) {
+    const byte *p = b->pages[page].read;
+    return p == b->ram || p == b->ram + MEM_PAGE_SIZE;
+}
+
+// Zero page and stack: pages 0 and 1 are always b->ram (see board_map()),
+// so these skip the page table. Writes only check for a write breakpoint.
+static inline byte board_read_zp(const Board *b, byte address) {
+    return b->ram[ZERO_PAGE + address];
+}
+
+static inline void board_write_zp(Board *b, byte address, byte data) {
+    b->ram[ZERO_PAGE + address] = data;
+    if (__builtin_expect(b->break_write == ZERO_PAGE + address, 0)) {
+        b->stop = true;
+    }
+}
+
+static inline byte board_read_stack(const Board *b, byte sp) {
+    return b->ram[STACK_BASE + sp];
+}
+
+static inline void board_write_stack(Board *b, byte sp, byte data) {
+    b->ram[STACK_BASE + sp] = data;
+    if (__builtin_expect(b->break_write == STACK_BASE + sp, 0)) {
+        b->stop = true;
+    }
+}
+
+// Queues fn to run at absolute cycle `cycle` (see board_cycles()), between
+// two instructions (blocks for the block engines). Returns an id for
+// board_cancel(), 0 if the queue is full.
+uint64_t board_schedule(Board *b, uint64_t cycle, event_t fn, void *data);
+bool board_cancel(Board *b, uint64_t id);
+
+// Cycle the running instruction started at, for device handlers
+static inline uint64_t board_cycles(const Board *b) {
+    return b->sched.now;
+}
+
+// Runs exactly `budget` cycles, throttled by the board clock. An instruction
+// (or block) that overruns the budget has its remaining cycles owed by the
+// next call. The CPU runs straight up to the next event, and idle spin loops
+// are fast-forwarded by whole iterations to it (or the next clock sync, or
+// the end of the budget) unless b->idle.enabled is false. Returns the cycles
+// run, fewer than `budget` when the run stops (b->stop) or the CPU halts
+// (b->c->halted, with PC and IR on the JAM opcode, or b->fault set), and
+// nothing at all while it stays halted.
+uint64_t board_run_cycles(Board *b, uint64_t budget);
+
+// Stops runs when PC reaches `pc` (-1 for none), checked between
+// instructions. Blocks and AOT code end ahead of it, so every engine stops
+// right on it.
+void board_break_pc(Board *b, int32_t pc);
+// Stops runs after the instruction that writes `address` (-1 for none),
+// false if it is out of range
+bool board_break_write(Board *b, int32_t address);
+// Halts the CPU on a fault (ACCESS_VIOLATION, ILLEGAL_OPCODE) at `address`
+// instead of exiting, the run stops after the instruction
+void board_fault(Board *b, byte error, addr address);
 
-void __run(Board *b);
+// Blocks the calling thread, at no host CPU cost, until board_signal_reset()
+// is called from another one, then resets the CPU
+void board_wait_reset(Board *b);
+// Wakes board_wait_reset(), now or the next time it is called
+void board_signal_reset(Board *b);
+// Resets the CPU if board_signal_reset() was called, without waiting
+bool board_poll_reset(Board *b);
 
 #endif // BOARD_H_
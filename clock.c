@@ -1,20 +1,121 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
 #include <stdio.h>
-#include <unistd.h>
 #include <time.h>
 
 #include "./board.h"
 
-void tick(Clock *clock, update_t update, Board *b) {
-    const long nanoseconds_per_second = 1000000000L;
-    struct timespec sleepTime;
+#define NANOSECONDS_PER_SECOND 1000000000L
+
+static struct timespec timespec_add_ns(struct timespec t, int64_t ns) {
+    t.tv_sec += ns / NANOSECONDS_PER_SECOND;
+    t.tv_nsec += ns % NANOSECONDS_PER_SECOND;
+    if (t.tv_nsec >= NANOSECONDS_PER_SECOND) {
+        t.tv_sec++;
+        t.tv_nsec -= NANOSECONDS_PER_SECOND;
+    } else if (t.tv_nsec < 0) {
+        t.tv_sec--;
+        t.tv_nsec += NANOSECONDS_PER_SECOND;
+    }
+    return t;
+}
+
+static int64_t timespec_diff_ns(struct timespec a, struct timespec b) {
+    return (int64_t)(a.tv_sec - b.tv_sec) * NANOSECONDS_PER_SECOND + (a.tv_nsec - b.tv_nsec);
+}
+
+// Host time needed to emulate the cycles run since the last rebase
+static int64_t cycles_to_ns(const Clock *clock, uint64_t cycles) {
+    double hz = (double)clock->frequency * clock->speed;
+    return (int64_t)((double)(cycles - clock->epoch_cycles) * NANOSECONDS_PER_SECOND / hz);
+}
 
-    // Calculate sleep time based on the frequency
-    sleepTime.tv_sec = 0;
-    sleepTime.tv_nsec = nanoseconds_per_second / clock->frequency;
+// Restart the epoch so the current cycle count maps to the current host time
+static void clock_rebase(Clock *clock, struct timespec now) {
+    clock->epoch = now;
+    clock->epoch_cycles = clock->cycles;
+}
+
+static void clock_sample(Clock *clock, struct timespec now) {
+    int64_t elapsed = timespec_diff_ns(now, clock->sample_time);
+    if (elapsed < CLOCK_REPORT_NS) {
+        return;
+    }
+    clock->mhz = (double)(clock->cycles - clock->sample_cycles) * 1000.0 / (double)elapsed;
+    clock->sample_time = now;
+    clock->sample_cycles = clock->cycles;
+}
+
+void clock_init(Clock *clock, long frequency) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    clock->frequency = frequency;
+    clock->slice = frequency / CLOCK_SLICE_HZ;
+    if (clock->slice == 0) {
+        clock->slice = 1;
+    }
+    clock->cycles = 0;
+    clock->next_sync = clock->slice;
+    clock->turbo = false;
+    clock->speed = 1.0;
+    clock->mhz = 0.0;
+    clock->sample_time = now;
+    clock->sample_cycles = 0;
+    clock_rebase(clock, now);
+}
+
+void clock_set_speed(Clock *clock, double speed) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    // Keep the cycles already run on the old rate, apply the new one from here
+    clock->speed = speed < CLOCK_MIN_SPEED ? CLOCK_MIN_SPEED : speed;
+    clock_rebase(clock, now);
+}
+
+void clock_set_turbo(Clock *clock, bool turbo) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    clock->turbo = turbo;
+    clock_rebase(clock, now);
+}
+
+void clock_sync(Clock *clock) {
+    struct timespec now;
+
+    clock->next_sync = clock->cycles + clock->slice;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    clock_sample(clock, now);
+    if (clock->turbo) {
+        return;
+    }
+
+    struct timespec deadline = timespec_add_ns(clock->epoch, cycles_to_ns(clock, clock->cycles));
+    int64_t lag = timespec_diff_ns(now, deadline);
+    if (lag > CLOCK_MAX_LAG_NS) {
+        // The host stalled (or the emulator was paused): restart the epoch
+        // here instead of running flat out until the backlog is gone
+        clock_rebase(clock, now);
+        return;
+    }
+    if (lag >= 0) {
+        return;
+    }
+
+    // Sleep against an absolute deadline so the error never accumulates
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR)
+        ;
+}
 
-    // Simulate a clock tick by sleeping
-    nanosleep(&sleepTime, NULL);
+void clock_advance(Clock *clock, uint64_t cycles) {
+    clock->cycles += cycles;
 
-    // clock the cpu
-    update(b->c);
+    // only hand the host back a slice at a time
+    if (clock->cycles >= clock->next_sync) {
+        clock_sync(clock);
+    }
 }
@@ -1,21 +1,81 @@
 #ifndef CRYSTOS_H_
 #define CRYSTOS_H_
 
-typedef struct Board Board;
-typedef struct cpu cpu;
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
 
-typedef struct {
-    long frequency; // Frequency in Hertz (cycles per second)
+// Number of throttling slices per emulated second (1ms slices)
+#define CLOCK_SLICE_HZ 1000
+
+// Lag behind real time after which the clock gives up catching up
+#define CLOCK_MAX_LAG_NS 50000000L
+
+// Window over which the achieved frequency is measured (1s)
+#define CLOCK_REPORT_NS 1000000000L
+
+// Slowest supported speed multiplier, there is no upper bound
+#define CLOCK_MIN_SPEED 0.25
+
+typedef struct Clock {
+    long frequency;        // Frequency in Hertz (cycles per second)
+    long slice;            // Cycles emulated between two host sleeps
+    uint64_t cycles;       // Cycles elapsed since the clock was started
+    uint64_t next_sync;    // Cycle count at which the next sleep is due
+
+    bool turbo;            // Run as fast as the host allows, no sleeping
+    double speed;          // Multiplier applied to frequency when throttled
+
+    struct timespec epoch; // Host monotonic time matching epoch_cycles
+    uint64_t epoch_cycles; // Cycle count at the last rebase
+
+    struct timespec sample_time; // Start of the current measurement window
+    uint64_t sample_cycles;      // Cycle count at the start of that window
+    double mhz;                  // Emulated MHz achieved over the last window
 } Clock;
 
-typedef void (*update_t)(struct cpu *c);
+/**
+ * Initializes the clock at the given frequency and starts its epoch now.
+ *
+ * @param clock Pointer to the Clock structure to initialize.
+ * @param frequency Emulated frequency in Hertz.
+ */
+void clock_init(Clock *clock, long frequency);
+
+/**
+ * Changes the speed multiplier, effective from the current cycle on.
+ * Values below CLOCK_MIN_SPEED are clamped.
+ *
+ * @param clock Pointer to the Clock structure to change.
+ * @param speed Multiplier applied to the nominal frequency (1.0 is real time).
+ */
+void clock_set_speed(Clock *clock, double speed);
+
+/**
+ * Enables or disables turbo mode. In turbo mode the clock never sleeps and
+ * only measures the achieved frequency.
+ *
+ * @param clock Pointer to the Clock structure to change.
+ * @param turbo true to skip throttling entirely.
+ */
+void clock_set_turbo(Clock *clock, bool turbo);
+
+/**
+ * Sleeps until the host catches up with the emulated cycle count.
+ * The deadline is absolute (epoch + cycles / (frequency * speed)) so
+ * oversleeping in one slice is paid back in the next one instead of
+ * accumulating. Also refreshes the achieved MHz measurement.
+ *
+ * @param clock Pointer to the Clock structure to synchronize.
+ */
+void clock_sync(Clock *clock);
 
 /**
- * Simulates a clock tick by sleeping for the duration based on the specified frequency
- * and then calling the provided update function.
- * 
- * @param clock Pointer to a Clock structure containing the clock frequency.
- * @param update Function pointer to the update function to be called on each tick.
+ * Accounts for cycles run by the caller and synchronizes with the host
+ * once a slice boundary is crossed.
+ *
+ * @param clock Pointer to the Clock structure to advance.
+ * @param cycles Number of cycles emulated since the last call.
  */
-void tick(Clock *clock, update_t update, struct Board *b);
+void clock_advance(Clock *clock, uint64_t cycles);
 #endif // !CRYSTOS_H_
@@ -2,6 +2,11 @@
 #include <stdlib.h>
 
 #include "./board.h"
+#include "./cpu_exec.h"
+#include "./alu.h"
+
+// The registers are touched by every instruction, keep them in one cache line
+_Static_assert(sizeof(cpu) <= 64, "cpu state no longer fits in a cache line");
 
 // Memory Read Function
 byte cpu_read(cpu *c, addr address) {
@@ -14,24 +19,8 @@ void cpu_write(cpu *c, addr address, byte data) {
 }
 
 
-void cpu_set_flag(cpu *c, byte flag, bool condition) {
-    if (condition) {
-        c->P |= flag;
-    } else {
-        c->P &= ~flag;
-    }
-}
-
-byte cpu_get_flag(cpu *c, byte flag) {
-    return (c->P & flag) ? 1 : 0;
-}
-
-cpu *cpu_init(void) {
-    cpu *c = (cpu *)malloc(sizeof(cpu));
-    if(c == NULL) {
-        return NULL;
-    }
-    cpu_code(c);
+void cpu_init(cpu *c) {
+    alu_init();
 
     c->bc = NULL;
     
@@ -45,39 +34,50 @@ cpu *cpu_init(void) {
     c->X = 0x00;
     c->Y = 0x00;
     c->SP = 0x00;
-    c->P = 0x02;
+    cpu_set_P(c, 0x02);
     c->nmi = TIED_HIGH;
     c->reset = TIED_LOW;
     c->irq = TIED_HIGH;
-    
-    return c;
+    c->halted = false;
 }
 
-void cpu_shutdown(cpu *c) {
-    free(c);
-}
-
-bool cpu_done(cpu *c) {
-    return c->cycles == 0;
+// Zero page operands are always internal RAM. Where c->IR is known at
+// compile time (the switch cores and cpu_exec handlers) this folds away.
+static inline bool cpu_operand_zp(const cpu *c) {
+    byte (*mode)(cpu *) = cpu_code_table[c->IR].addressing_mode;
+    return mode == &ZPG || mode == &ZPX || mode == &ZPY;
 }
 
 byte cpu_decode(cpu *c) {
-    if(c->code[c->IR].addressing_mode != &IMP && c->code[c->IR].addressing_mode != &IMP) // CHECK THIS FIRST FOR ANY LATER BUGS
+    if (cpu_operand_zp(c))
+        c->data_bus = board_read_zp(c->bc, c->address_bus);
+    else if(cpu_code_table[c->IR].addressing_mode != &IMP) // CHECK THIS FIRST FOR ANY LATER BUGS
         c->data_bus = cpu_read(c, c->address_bus);
     return c->data_bus;
 }
 
+// Stores to the operand address
+static inline void cpu_write_operand(cpu *c, byte data) {
+    if (cpu_operand_zp(c))
+        board_write_zp(c->bc, c->address_bus, data);
+    else
+        cpu_write(c, c->address_bus, data);
+}
+
 void cpu_nmi(cpu *c) {
-    cpu_write(c, STACK_BASE + c->SP, (c->PC >> 8) & 0x00FF);
+    board_write_stack(c->bc, c->SP, (c->PC >> 8) & 0x00FF);
 	c->SP--;
-	cpu_write(c, STACK_BASE + c->SP, c->PC & 0x00FF);
+	board_write_stack(c->bc, c->SP, c->PC & 0x00FF);
 	c->SP--;
 
 	cpu_set_flag(c, FLAG_B, 0);
 	cpu_set_flag(c, FLAG_U, 1);
 	cpu_set_flag(c, FLAG_I, 1);
-	cpu_write(c, STACK_BASE + c->SP, c->P);
+	board_write_stack(c->bc, c->SP, cpu_get_P(c));
 	c->SP--;
+#ifdef CPU_VARIANT_65C02
+	cpu_set_flag(c, FLAG_D, 0);
+#endif // CPU_VARIANT_65C02
 
 	c->address_bus = NMI;
 	addr lo = cpu_read(c, c->address_bus + 0);
@@ -91,7 +91,7 @@ void cpu_reset(cpu* c) {
     // Assume reset is already initiated; prepare for the reset sequence
     
     c->SP = 0xFD; // Stack pointer usually set to 0xFF on reset
-    c->P = 0x24; // Status register with UNUSED and IRQ disable flags set
+    cpu_set_P(c, 0x24); // Status register with UNUSED and IRQ disable flags set
         
     // Read reset vector into PC
     word lowByte = cpu_read(c, RESET);
@@ -100,6 +100,7 @@ void cpu_reset(cpu* c) {
 
     // Reset complete; further initialization as needed
     c->reset = TIED_HIGH; // Indicate reset completed
+    c->halted = false;
     c->cycles = 8; // Ready for next operation 
 }
 
@@ -108,17 +109,20 @@ void cpu_irq(cpu *c) {
 	{
 		// Push the program counter to the stack. It's 16-bits dont
 		// forget so that takes two pushes
-		cpu_write(c, STACK_BASE + c->SP, (c->PC >> 8) & 0x00FF);
+		board_write_stack(c->bc, c->SP, (c->PC >> 8) & 0x00FF);
 		c->SP--;
-		cpu_write(c, STACK_BASE + c->SP, c->PC & 0x00FF);
+		board_write_stack(c->bc, c->SP, c->PC & 0x00FF);
 		c->SP--;
 
 		// Then Push the status register to the stack
 		cpu_set_flag(c, FLAG_B, 0);
 		cpu_set_flag(c, FLAG_U, 1);
 		cpu_set_flag(c, FLAG_I, 1);
-		cpu_write(c, STACK_BASE + c->SP, c->P);
+		board_write_stack(c->bc, c->SP, cpu_get_P(c));
 		c->SP--;
+#ifdef CPU_VARIANT_65C02
+		cpu_set_flag(c, FLAG_D, 0);
+#endif // CPU_VARIANT_65C02
 
 		// Read new program counter location from fixed address
 		c->address_bus = IRQ;
@@ -131,18 +135,148 @@ void cpu_irq(cpu *c) {
 	}
 }
 
-void cpu_clock(cpu *c) {
-    if (c->cycles == 0) {
-        c->IR = cpu_read(c, c->PC);
-        cpu_set_flag(c, FLAG_U, true);
-        c->PC++;
-        c->cycles = c->code[c->IR].cycles;
-        byte cycle1 = (c->code[c->IR].addressing_mode)(c);
-        byte cycle2 = (c->code[c->IR].opcode)(c);
-        c->cycles += (cycle1 & cycle2);
-        cpu_set_flag(c, FLAG_U, true);
+byte cpu_interrupt(cpu *c) {
+    if (c->halted) {
+        // a jammed cpu does not answer interrupts either
+        return 0;
+    }
+    // cpu_nmi()/cpu_irq() leave their cost in c->cycles, which may still hold
+    // cycles owed by the previous instruction
+    byte owed = c->cycles;
+    byte cycles = 0;
+    if (c->nmi == TIED_LOW) {
+        // edge triggered, the line is latched until serviced
+        c->nmi = TIED_HIGH;
+        cpu_nmi(c);
+        cycles = c->cycles;
+    } else if (c->irq == TIED_LOW && cpu_get_flag(c, FLAG_I) == 0) {
+        cpu_irq(c);
+        cycles = c->cycles;
+    }
+    c->cycles = owed;
+    return cycles;
+}
+
+// Table core: two indirect calls per instruction through c->code
+byte cpu_step_table(cpu *c) {
+    c->IR = cpu_read(c, c->PC);
+    cpu_set_flag(c, FLAG_U, true);
+    c->PC++;
+    // branches add their penalty cycles straight to c->cycles
+    c->cycles = cpu_code_table[c->IR].cycles;
+    byte cycle1 = (cpu_code_table[c->IR].addressing_mode)(c);
+    byte cycle2 = (cpu_code_table[c->IR].opcode)(c);
+    c->cycles += (cycle1 & cycle2);
+    cpu_set_flag(c, FLAG_U, true);
+
+    byte cycles = c->cycles;
+    c->cycles = 0;
+    return cycles;
+}
+
+// Switch core: one case per opcode so the compiler can inline both the
+// addressing mode and the operation behind a single jump table
+byte cpu_step_switch(cpu *c) {
+    c->IR = cpu_read(c, c->PC);
+    cpu_set_flag(c, FLAG_U, true);
+    c->PC++;
+    switch (c->IR) {
+#define OPCODE(op, str, mode, fn, cyc)      \
+    case op: {                              \
+        c->cycles = cyc;                    \
+        byte cycle1 = mode(c);              \
+        byte cycle2 = fn(c);                \
+        c->cycles += (cycle1 & cycle2);     \
+        break;                              \
+    }
+#include "./opcodes.def"
+#undef OPCODE
+    }
+    cpu_set_flag(c, FLAG_U, true);
+
+    byte cycles = c->cycles;
+    c->cycles = 0;
+    return cycles;
+}
+
+byte cpu_step(cpu *c) {
+    if (c->halted) {
+        return 0;
+    }
+    if (c->nmi == TIED_LOW || c->irq == TIED_LOW) {
+        byte cycles = cpu_interrupt(c);
+        if (cycles != 0) {
+            return cycles;
+        }
+    }
+#ifdef CPU_CORE_SWITCH
+    return cpu_step_switch(c);
+#else
+    return cpu_step_table(c);
+#endif // CPU_CORE_SWITCH
+}
+
+// Batch core: the switch core run on a local copy of the registers. Every
+// handler is flattened in, so the copy never escapes and the compiler keeps
+// it in host registers across instructions, board_read()/board_write() go
+// straight to the page table through the board pointer held in it. The
+// interrupt lines stay in *c, where devices pull them.
+__attribute__((flatten)) uint32_t cpu_run(cpu *c, uint32_t budget) {
+    Board *b = c->bc;
+    const Scheduler *s = &b->sched;
+    uint64_t start = s->now;
+    uint64_t now = start;
+    uint64_t limit = start + budget;
+    uint64_t ops = 0;
+    cpu r = *c;
+
+    while (now < limit && !r.halted && !b->stop && r.PC != b->break_pc) {
+        if (c->nmi == TIED_LOW || (c->irq == TIED_LOW && cpu_get_flag(&r, FLAG_I) == 0)) {
+            // left to cpu_step()
+            break;
+        }
+        r.IR = cpu_read(&r, r.PC);
+        cpu_set_flag(&r, FLAG_U, true);
+        r.PC++;
+        switch (r.IR) {
+#define OPCODE(op, str, mode, fn, cyc)      \
+        case op: {                          \
+            r.cycles = cyc;                 \
+            byte cycle1 = mode(&r);         \
+            byte cycle2 = fn(&r);           \
+            r.cycles += (cycle1 & cycle2);  \
+            break;                          \
+        }
+#include "./opcodes.def"
+#undef OPCODE
+        }
+        cpu_set_flag(&r, FLAG_U, true);
+        now += r.cycles;
+        ops++;
+        if (s->next < limit) {
+            // scheduled by a device during the instruction
+            limit = s->next;
+        }
+    }
+
+    r.cycles = 0;
+    // halted by a fault in board_write_io()
+    r.halted |= c->halted;
+    r.nmi = c->nmi;
+    r.reset = c->reset;
+    r.irq = c->irq;
+    *c = r;
+    b->batch_ops += ops;
+    return now - start;
+}
+
+byte cpu_step_batch(cpu *c) {
+    byte cycles = cpu_run(c, CPU_BATCH_STEP_CYCLES);
+    if (cycles != 0) {
+        return cycles;
     }
-    c->cycles--;
+    c->bc->batch_ops++;
+    return cpu_step(c);
 }
 
 // ADDRESSING MODES
@@ -173,14 +307,14 @@ byte ZPG(cpu *c) {
 }
 
 byte ZPX(cpu *c) { 
-    c->address_bus = cpu_read(c, c->PC + c->X);
+    c->address_bus = cpu_read(c, c->PC) + c->X;
     c->PC++;
 	c->address_bus &= 0x00FF;
     return 0; 
 }
 
 byte ZPY(cpu *c) { 
-    c->address_bus = cpu_read(c, c->PC + c->Y);
+    c->address_bus = cpu_read(c, c->PC) + c->Y;
     c->PC++;
 	c->address_bus &= 0x00FF;
     return 0; 
@@ -239,12 +373,16 @@ byte IND(cpu *c) {
     
     addr ptr = (ptr_hi << 8) | ptr_lo;
 
+#ifdef CPU_VARIANT_65C02
+    c->address_bus = (cpu_read(c, ptr + 1) << 8) | cpu_read(c, ptr);
+#else
     // Handle page boundary bug
     if ((ptr & 0x00FF) == 0x00FF) {
         c->address_bus = (cpu_read(c, ptr & 0xFF00) << 8) | cpu_read(c, ptr);
     } else {
         c->address_bus = (cpu_read(c, ptr + 1) << 8) | cpu_read(c, ptr);
     }
+#endif // CPU_VARIANT_65C02
 
     return 0;
 }
@@ -253,8 +391,8 @@ byte IZY(cpu *c) {
     addr tmp = cpu_read(c, c->PC);
     c->PC++;
 
-    addr lo = cpu_read(c, tmp & 0xFF);
-    addr hi = cpu_read(c, (tmp + 1) & 0xFF);
+    addr lo = board_read_zp(c->bc, tmp);
+    addr hi = board_read_zp(c->bc, tmp + 1);
 
     c->address_bus = (hi << 8) | lo;
     c->address_bus += c->Y;
@@ -271,8 +409,8 @@ byte IZX(cpu *c) {
     addr tmp = cpu_read(c, c->PC);
     c->PC++;
 
-    addr lo = cpu_read(c, (addr)(tmp + (addr)c->X) & 0xFF);
-    addr hi = cpu_read(c, (addr)(tmp + (addr)c->X + 1) & 0xFF);
+    addr lo = board_read_zp(c->bc, tmp + c->X);
+    addr hi = board_read_zp(c->bc, tmp + c->X + 1);
 
     c->address_bus = (hi << 8) | lo;
 
@@ -287,30 +425,106 @@ byte REL(cpu *c) {
     return 0; 
 }
 
+#ifdef CPU_VARIANT_65C02
+byte ZPI(cpu *c) {
+    addr tmp = cpu_read(c, c->PC);
+    c->PC++;
+
+    addr lo = board_read_zp(c->bc, tmp);
+    addr hi = board_read_zp(c->bc, tmp + 1);
+
+    c->address_bus = (hi << 8) | lo;
+
+    return 0;
+}
+
+byte IAX(cpu *c) {
+    addr lo = cpu_read(c, c->PC);
+    c->PC++;
+    addr hi = cpu_read(c, c->PC);
+    c->PC++;
+
+    addr ptr = ((hi << 8) | lo) + c->X;
+    c->address_bus = (cpu_read(c, ptr + 1) << 8) | cpu_read(c, ptr);
+
+    return 0;
+}
+#endif // CPU_VARIANT_65C02
+
+// Runs c->IR with its predecoded operand, one inlined case per opcode
+byte cpu_step_decoded(cpu *c, word operand) {
+    c->P |= FLAG_U;
+    switch (c->IR) {
+#define OPCODE(op, str, mode, fn, cyc)              \
+    case op: {                                      \
+        c->cycles = cyc;                            \
+        byte cycle1 = mode##_resolve(c, operand);   \
+        byte cycle2 = fn(c);                        \
+        c->cycles += (cycle1 & cycle2);             \
+        break;                                      \
+    }
+#include "./opcodes.def"
+#undef OPCODE
+    }
+    c->P |= FLAG_U;
+
+    byte cycles = c->cycles;
+    c->cycles = 0;
+    return cycles;
+}
+
+// Handlers from cpu_exec.h, for engines that store one per decoded instruction
+const cpu_exec_t cpu_exec_table[0x0100] = {
+#define OPCODE(op, str, mode, fn, cyc) [op] = cpu_exec_##op,
+#include "./opcodes.def"
+#undef OPCODE
+};
+
+// Superinstructions for the block engine, from fused.def (see profile.c).
+// Each runs its opcodes' cpu_exec handlers back to back, inlined together
+// with the operations here. Blocks only check interrupts between them, so
+// fusing inside one moves no sampling point, and every instruction still
+// adds its own cycles.
+#define FUSED_OP(i, opcode)                         \
+    c->IR = opcode;                                 \
+    c->PC += ops[i].length;                         \
+    cycles += cpu_exec_##opcode(c, ops[i].operand);
+#define FUSE2(a, b)                                                         \
+    static byte cpu_fused_##a##_##b(cpu *c, const BlockOp *ops) {           \
+        byte cycles = 0;                                                    \
+        FUSED_OP(0, a) FUSED_OP(1, b)                                       \
+        return cycles;                                                      \
+    }
+#define FUSE3(a, b, d)                                                      \
+    static byte cpu_fused_##a##_##b##_##d(cpu *c, const BlockOp *ops) {     \
+        byte cycles = 0;                                                    \
+        FUSED_OP(0, a) FUSED_OP(1, b) FUSED_OP(2, d)                        \
+        return cycles;                                                      \
+    }
+#include "./fused.def"
+#undef FUSE2
+#undef FUSE3
+#undef FUSED_OP
+
+const cpu_fused_t cpu_fused_table[] = {
+    {{0}, 0, NULL},
+#define FUSE2(a, b) {{a, b}, 2, cpu_fused_##a##_##b},
+#define FUSE3(a, b, d) {{a, b, d}, 3, cpu_fused_##a##_##b##_##d},
+#include "./fused.def"
+#undef FUSE2
+#undef FUSE3
+};
+
+const byte cpu_fused_count = sizeof(cpu_fused_table) / sizeof(cpu_fused_table[0]);
+
 // LEGAL OPCODES
 byte ADC(cpu *c) {
-    // Grab the data that we are adding to the accumulator
-	cpu_decode(c);
-	
-	// Add is performed in 16-bit domain for emulation to capture any
-	// carry bit, which will exist in bit 8 of the 16-bit word
-	byte temp = (addr)c->A + (addr)c->data_bus + (addr)cpu_get_flag(c, FLAG_C);
-	
-	// The carry flag out exists in the high byte bit 0
-	cpu_set_flag(c, FLAG_C, temp > 255);
-	
-	// The Zero flag is set if the result is 0
-	cpu_set_flag(c, FLAG_Z, (temp & 0x00FF) == 0);
-	
-	// The signed Overflow flag is set based on all that up there! :D
-	cpu_set_flag(c, FLAG_V, (~((addr)c->A ^ (addr)c->data_bus) & ((addr)c->A ^ (addr)temp)) & 0x0080);
-	
-	// The negative flag is set to the most significant bit of the result
-	cpu_set_flag(c, FLAG_N, temp & 0x80);
-	
-	// Load the result into the accumulator (it's 8-bit dont forget!)
-	c->A = temp & 0x00FF;
-	
+    alu_adc(c, cpu_decode(c));
+#ifdef CPU_VARIANT_65C02
+	// one more cycle to fix the flags up in decimal mode
+	c->cycles += alu_decimal(c);
+#endif // CPU_VARIANT_65C02
+
 	// This instruction has the potential to require an additional clock cycle
 	return 1;
 }
@@ -319,8 +533,7 @@ byte AND(cpu *c) {
     byte data = cpu_decode(c);
     c->A &= data;
 
-    cpu_set_flag(c, FLAG_Z, c->A == 0x00);
-    cpu_set_flag(c, FLAG_N, c->A & 0x80);
+    cpu_set_nz(c, c->A);
     
     return 1;
 }
@@ -329,12 +542,11 @@ byte ASL(cpu *c) {
     cpu_decode(c);
 	byte temp = (addr)c->data_bus << 1;
 	cpu_set_flag(c, FLAG_C, (temp & 0xFF00) > 0);
-	cpu_set_flag(c, FLAG_Z, (temp & 0x00FF) == 0x00);
-	cpu_set_flag(c, FLAG_N, temp & 0x80);
-	if (c->code[c->IR].addressing_mode == &IMP)
+	cpu_set_nz(c, temp);
+	if (cpu_code_table[c->IR].addressing_mode == &IMP)
 		c->A = temp & 0x00FF;
 	else
-		cpu_write(c, c->address_bus, temp & 0x00FF);
+		cpu_write_operand(c, temp & 0x00FF);
     return 0;
 }
 
@@ -435,15 +647,18 @@ byte BRK(cpu *c) {
     c->PC++;
 	
 	cpu_set_flag(c, FLAG_I, 1);
-	cpu_write(c, STACK_BASE + c->SP, (c->PC >> 8) & 0x00FF);
+	board_write_stack(c->bc, c->SP, (c->PC >> 8) & 0x00FF);
 	c->SP--;
-	cpu_write(c, STACK_BASE + c->SP, c->PC & 0x00FF);
+	board_write_stack(c->bc, c->SP, c->PC & 0x00FF);
 	c->SP--;
 
 	cpu_set_flag(c, FLAG_B, 1);
-	cpu_write(c, STACK_BASE + c->SP, c->P);
+	board_write_stack(c->bc, c->SP, cpu_get_P(c));
 	c->SP--;
 	cpu_set_flag(c, FLAG_B, 0);
+#ifdef CPU_VARIANT_65C02
+	cpu_set_flag(c, FLAG_D, 0);
+#endif // CPU_VARIANT_65C02
 
 	c->PC = (addr)cpu_read(c, IRQ) | ((addr)cpu_read(c, IRQ + 1) << 8);
 	return 0;
@@ -498,83 +713,64 @@ byte CLV(cpu *c) {
 }
 
 byte CMP(cpu *c) {
-	cpu_decode(c);
-	byte temp = (addr)c->A - (addr)c->data_bus;
-	cpu_set_flag(c, FLAG_C, c->A >= c->data_bus);
-	cpu_set_flag(c, FLAG_Z, (temp & 0x00FF) == 0x0000);
-	cpu_set_flag(c, FLAG_N, temp & 0x0080);
+	alu_cmp(c, c->A, cpu_decode(c));
 	return 1;
 }
 
 byte CPX(cpu *c) {
-    cpu_decode(c);
-	byte temp = (addr)c->X - (addr)c->data_bus;
-	cpu_set_flag(c, FLAG_C, c->X >= c->data_bus);
-	cpu_set_flag(c, FLAG_Z, (temp & 0x00FF) == 0x0000);
-	cpu_set_flag(c, FLAG_N, temp & 0x0080);
+	alu_cmp(c, c->X, cpu_decode(c));
 	return 0;
 }
 
 byte CPY(cpu *c) {
-    cpu_decode(c);
-	byte temp = (addr)c->Y - (addr)c->data_bus;
-	cpu_set_flag(c, FLAG_C, c->Y >= c->data_bus);
-	cpu_set_flag(c, FLAG_Z, (temp & 0x00FF) == 0x0000);
-	cpu_set_flag(c, FLAG_N, temp & 0x0080);
+	alu_cmp(c, c->Y, cpu_decode(c));
 	return 0;
 }
 
 byte DEC(cpu *c) {
     cpu_decode(c);
 	byte temp = c->data_bus - 1;
-	cpu_write(c, c->address_bus, temp & 0x00FF);
-	cpu_set_flag(c, FLAG_Z, (temp & 0x00FF) == 0x0000);
-	cpu_set_flag(c, FLAG_N, temp & 0x0080);
+	cpu_write_operand(c, temp & 0x00FF);
+	cpu_set_nz(c, temp);
 	return 0;
 }
 
 byte DEX(cpu *c) {
     c->X--;
-	cpu_set_flag(c, FLAG_Z, c->X == 0x00);
-	cpu_set_flag(c, FLAG_N, c->X & 0x80);
+	cpu_set_nz(c, c->X);
 	return 0;
 }
 
 byte DEY(cpu *c) {
     c->Y--;
-	cpu_set_flag(c, FLAG_Z, c->Y == 0x00);
-	cpu_set_flag(c, FLAG_N, c->Y & 0x80);
+	cpu_set_nz(c, c->Y);
 	return 0;
 }
 
 byte EOR(cpu *c) {
     cpu_decode(c);
 	c->A = c->A ^ c->data_bus;	
-	cpu_set_flag(c, FLAG_Z, c->A == 0x00);
-	cpu_set_flag(c, FLAG_N, c->A & 0x80);
+	cpu_set_nz(c, c->A);
 	return 1;
 }
 
 byte INC(cpu *c) {
     cpu_decode(c);
 	byte temp = c->data_bus + 1;
-	cpu_write(c, c->address_bus, temp & 0x00FF);
-	cpu_set_flag(c, FLAG_Z, (temp & 0x00FF) == 0x0000);
-	cpu_set_flag(c, FLAG_N, temp & 0x0080);
+	cpu_write_operand(c, temp & 0x00FF);
+	cpu_set_nz(c, temp);
 	return 0;
 }
 
 byte INX(cpu *c) {
     c->X++;
-	cpu_set_flag(c, FLAG_Z, c->X == 0x00);
-	cpu_set_flag(c, FLAG_N, c->X & 0x80);
+	cpu_set_nz(c, c->X);
 	return 0;
 }
 
 byte INY(cpu *c) {
     c->Y++;
-	cpu_set_flag(c, FLAG_Z, c->X == 0x00);
-	cpu_set_flag(c, FLAG_N, c->X & 0x80);
+	cpu_set_nz(c, c->X);
 	return 0;
 }
 
@@ -586,9 +782,9 @@ byte JMP(cpu *c) {
 byte JSR(cpu *c) {
     c->PC--;
 
-	cpu_write(c, STACK_BASE + c->SP, (c->PC >> 8) & 0x00FF);
+	board_write_stack(c->bc, c->SP, (c->PC >> 8) & 0x00FF);
 	c->SP--;
-	cpu_write(c, STACK_BASE + c->SP, c->PC & 0x00FF);
+	board_write_stack(c->bc, c->SP, c->PC & 0x00FF);
 	c->SP--;
 
 	c->PC = c->address_bus;
@@ -598,24 +794,21 @@ byte JSR(cpu *c) {
 byte LDA(cpu *c) {
     cpu_decode(c);
 	c->A = c->data_bus;
-	cpu_set_flag(c, FLAG_Z, c->A == 0x00);
-	cpu_set_flag(c, FLAG_N, c->A & 0x80);
+	cpu_set_nz(c, c->A);
 	return 1;
 }
 
 byte LDX(cpu *c) {
     cpu_decode(c);
 	c->X = c->data_bus;
-	cpu_set_flag(c, FLAG_Z, c->X == 0x00);
-	cpu_set_flag(c, FLAG_N, c->X & 0x80);
+	cpu_set_nz(c, c->X);
 	return 1;
 }
 
 byte LDY(cpu *c) {
     cpu_decode(c);
 	c->Y = c->data_bus;
-	cpu_set_flag(c, FLAG_Z, c->Y == 0x00);
-	cpu_set_flag(c, FLAG_N, c->Y & 0x80);
+	cpu_set_nz(c, c->Y);
 	return 1;
 }
 
@@ -623,12 +816,11 @@ byte LSR(cpu *c) {
     cpu_decode(c);
 	cpu_set_flag(c, FLAG_C, c->data_bus & 0x0001);
 	byte temp = c->data_bus >> 1;	
-	cpu_set_flag(c, FLAG_Z, (temp & 0x00FF) == 0x0000);
-	cpu_set_flag(c, FLAG_N, temp & 0x0080);
-	if (c->code[c->IR].addressing_mode == &IMP)
+	cpu_set_nz(c, temp);
+	if (cpu_code_table[c->IR].addressing_mode == &IMP)
 		c->A = temp & 0x00FF;
 	else
-		cpu_write(c, c->address_bus, temp & 0x00FF);
+		cpu_write_operand(c, temp & 0x00FF);
 	return 0;
 }
 
@@ -649,19 +841,18 @@ byte NOP(cpu *c) {
 byte ORA(cpu *c) {
     cpu_decode(c);
 	c->A = c->A | c->data_bus;
-	cpu_set_flag(c, FLAG_Z, c->A == 0x00);
-	cpu_set_flag(c, FLAG_N, c->A & 0x80);
+	cpu_set_nz(c, c->A);
 	return 1;
 }
 
 byte PHA(cpu *c) {
-    cpu_write(c, STACK_BASE + c->SP, c->A);
+    board_write_stack(c->bc, c->SP, c->A);
 	c->SP--;
 	return 0;
 }
 
 byte PHP(cpu *c) {
-    cpu_write(c, STACK_BASE + c->SP, c->P | FLAG_B | FLAG_U);
+    board_write_stack(c->bc, c->SP, cpu_get_P(c) | FLAG_B | FLAG_U);
 	cpu_set_flag(c, FLAG_B, 0);
 	cpu_set_flag(c, FLAG_U, 0);
 	c->SP--;
@@ -670,15 +861,14 @@ byte PHP(cpu *c) {
 
 byte PLA(cpu *c) {
     c->SP++;
-	c->A = cpu_read(c, STACK_BASE + c->SP);
-	cpu_set_flag(c, FLAG_Z, c->A == 0x00);
-	cpu_set_flag(c, FLAG_N, c->A & 0x80);
+	c->A = board_read_stack(c->bc, c->SP);
+	cpu_set_nz(c, c->A);
 	return 0;
 }
 
 byte PLP(cpu *c) {
     c->SP++;
-	c->P = cpu_read(c, STACK_BASE + c->SP);
+	cpu_set_P(c, board_read_stack(c->bc, c->SP));
 	cpu_set_flag(c, FLAG_U, 1);
 	return 0;
 }
@@ -687,12 +877,11 @@ byte ROL(cpu *c) {
     cpu_decode(c);
 	byte temp = (addr)(c->data_bus << 1) | cpu_get_flag(c, FLAG_C);
 	cpu_set_flag(c, FLAG_C, temp & 0xFF00);
-	cpu_set_flag(c, FLAG_Z, (temp & 0x00FF) == 0x0000);
-	cpu_set_flag(c, FLAG_N, temp & 0x0080);
-	if (c->code[c->IR].addressing_mode == &IMP)
+	cpu_set_nz(c, temp);
+	if (cpu_code_table[c->IR].addressing_mode == &IMP)
 		c->A = temp & 0x00FF;
 	else
-		cpu_write(c, c->address_bus, temp & 0x00FF);
+		cpu_write_operand(c, temp & 0x00FF);
 	return 0;
 }
 
@@ -700,53 +889,42 @@ byte ROR(cpu *c) {
     cpu_decode(c);
 	byte temp = (addr)(cpu_get_flag(c, FLAG_C) << 7) | (c->data_bus >> 1);
 	cpu_set_flag(c, FLAG_C, c->data_bus & 0x01);
-	cpu_set_flag(c, FLAG_Z, (temp & 0x00FF) == 0x00);
-	cpu_set_flag(c, FLAG_N, temp & 0x0080);
-	if (c->code[c->IR].addressing_mode == &IMP)
+	cpu_set_nz(c, temp);
+	if (cpu_code_table[c->IR].addressing_mode == &IMP)
 		c->A = temp & 0x00FF;
 	else
-		cpu_write(c, c->address_bus, temp & 0x00FF);
+		cpu_write_operand(c, temp & 0x00FF);
 	return 0;
 }
 
 byte RTI(cpu *c) {
     c->SP++;
-	c->P = cpu_read(c, STACK_BASE + c->SP);
+	cpu_set_P(c, board_read_stack(c->bc, c->SP));
 	c->P &= ~FLAG_B;
 	c->P &= ~FLAG_U;
 
 	c->SP++;
-	c->PC = (addr)cpu_read(c, STACK_BASE + c->SP);
-	c->P++;
-	c->PC |= (addr)cpu_read(c, STACK_BASE + c->SP) << 8;
+	c->PC = (addr)board_read_stack(c->bc, c->SP);
+	cpu_set_P(c, cpu_get_P(c) + 1);
+	c->PC |= (addr)board_read_stack(c->bc, c->SP) << 8;
 	return 0;
 }
 
 byte RTS(cpu *c) {
     c->SP++;
-	c->PC = (addr)cpu_read(c, STACK_BASE + c->SP);
+	c->PC = (addr)board_read_stack(c->bc, c->SP);
 	c->SP++;
-	c->PC |= (addr)cpu_read(c, STACK_BASE + c->SP) << 8;
+	c->PC |= (addr)board_read_stack(c->bc, c->SP) << 8;
 	
 	c->PC++;
 	return 0;
 }
 
 byte SBC(cpu *c) {
-    cpu_decode(c);
-	
-	// Operating in 16-bit domain to capture carry out
-	
-	// We can invert the bottom 8 bits with bitwise xor
-	addr value = ((addr)c->data_bus) ^ 0x00FF;
-	
-	// Notice this is exactly the same as addition from here!
-	byte temp = (addr)c->A + value + (addr)cpu_get_flag(c, FLAG_C);
-	cpu_set_flag(c, FLAG_C, temp & 0xFF00);
-	cpu_set_flag(c, FLAG_Z, ((temp & 0x00FF) == 0));
-	cpu_set_flag(c, FLAG_V, (temp ^ (addr)c->A) & (temp ^ value) & 0x0080);
-	cpu_set_flag(c, FLAG_N, temp & 0x0080);
-	c->A = temp & 0x00FF;
+    alu_sbc(c, cpu_decode(c));
+#ifdef CPU_VARIANT_65C02
+	c->cycles += alu_decimal(c);
+#endif // CPU_VARIANT_65C02
 	return 1;
 }
 
@@ -766,46 +944,42 @@ byte SEI(cpu *c) {
 }
 
 byte STA(cpu *c) {
-    cpu_write(c, c->address_bus, c->A);
+    cpu_write_operand(c, c->A);
     return 0;
 }
 
 byte STX(cpu *c) {
-    cpu_write(c, c->address_bus, c->X);
+    cpu_write_operand(c, c->X);
     return 0;
 }
 
 byte STY(cpu *c) {
-    cpu_write(c, c->address_bus, c->Y);
+    cpu_write_operand(c, c->Y);
     return 0;
 }
 
 byte TAX(cpu *c) {
     c->X = c->A;
-	cpu_set_flag(c, FLAG_Z, c->X == 0x00);
-	cpu_set_flag(c, FLAG_N, c->X & 0x80);
+	cpu_set_nz(c, c->X);
 	return 0;
 }
 
 byte TAY(cpu *c) {
     c->Y = c->A;
-	cpu_set_flag(c, FLAG_Z, c->Y == 0x00);
-	cpu_set_flag(c, FLAG_N, c->Y & 0x80);
+	cpu_set_nz(c, c->Y);
 	return 0;
 }
 
 byte TSX(cpu *c) {
     c->SP = c->A & c->X;
-    c->X = c->P;
-	cpu_set_flag(c, FLAG_Z, c->X == 0x00);
-	cpu_set_flag(c, FLAG_N, c->X & 0x80);
+    c->X = cpu_get_P(c);
+	cpu_set_nz(c, c->X);
 	return 0;
 }
 
 byte TXA(cpu *c) {
     c->A = c->X;
-	cpu_set_flag(c, FLAG_Z, c->A == 0x00);
-	cpu_set_flag(c, FLAG_N, c->A & 0x80);
+	cpu_set_nz(c, c->A);
 	return 0;
 }
 
@@ -816,11 +990,89 @@ byte TXS(cpu *c) {
 
 byte TYA(cpu *c) {
     c->A = c->Y;
-	cpu_set_flag(c, FLAG_Z, c->A == 0x00);
-	cpu_set_flag(c, FLAG_N, c->A & 0x80);
+	cpu_set_nz(c, c->A);
+	return 0;
+}
+
+#ifdef CPU_VARIANT_65C02
+// 65C02 OPCODES
+
+byte BRA(cpu *c) {
+    c->cycles++;
+	c->address_bus = c->PC + c->address_relative;
+
+	if ((c->address_bus & 0xFF00) != (c->PC & 0xFF00))
+		c->cycles++;
+
+	c->PC = c->address_bus;
+	return 0;
+}
+
+byte BIT_imm(cpu *c) {
+    cpu_decode(c);
+	cpu_set_flag(c, FLAG_Z, (c->A & c->data_bus) == 0x00);
+	return 0;
+}
+
+byte INA(cpu *c) {
+    c->A++;
+	cpu_set_nz(c, c->A);
+	return 0;
+}
+
+byte DEA(cpu *c) {
+    c->A--;
+	cpu_set_nz(c, c->A);
+	return 0;
+}
+
+byte PHX(cpu *c) {
+    board_write_stack(c->bc, c->SP, c->X);
+	c->SP--;
 	return 0;
 }
 
+byte PLX(cpu *c) {
+    c->SP++;
+	c->X = board_read_stack(c->bc, c->SP);
+	cpu_set_nz(c, c->X);
+	return 0;
+}
+
+byte PHY(cpu *c) {
+    board_write_stack(c->bc, c->SP, c->Y);
+	c->SP--;
+	return 0;
+}
+
+byte PLY(cpu *c) {
+    c->SP++;
+	c->Y = board_read_stack(c->bc, c->SP);
+	cpu_set_nz(c, c->Y);
+	return 0;
+}
+
+byte STZ(cpu *c) {
+    cpu_write_operand(c, 0);
+    return 0;
+}
+
+byte TRB(cpu *c) {
+    cpu_decode(c);
+	cpu_set_flag(c, FLAG_Z, (c->A & c->data_bus) == 0x00);
+	cpu_write_operand(c, c->data_bus & ~c->A);
+	return 0;
+}
+
+byte TSB(cpu *c) {
+    cpu_decode(c);
+	cpu_set_flag(c, FLAG_Z, (c->A & c->data_bus) == 0x00);
+	cpu_write_operand(c, c->data_bus | c->A);
+	return 0;
+}
+
+#else
+
 /** ILLEGAL OPCODES USE AT YOUR OWN RISK
 
  ***!!!BEWARE, FORGOTTEN POWERS LURK BEYOND!!!***
@@ -836,8 +1088,7 @@ byte ALR(cpu *c) {
 
     // Set flags
     cpu_set_flag(c, FLAG_C, carry);
-    cpu_set_flag(c, FLAG_Z, c->A == 0);
-    cpu_set_flag(c, FLAG_N, c->A & 0x80);
+    cpu_set_nz(c, c->A);
 
     return 0; // No extra cycle needed
 }
@@ -848,8 +1099,7 @@ byte ANC(cpu *c) {
 
     // Set Carry and other flags
     cpu_set_flag(c, FLAG_C, c->A & 0x80);
-    cpu_set_flag(c, FLAG_Z, c->A == 0);
-    cpu_set_flag(c, FLAG_N, c->A & 0x80);
+    cpu_set_nz(c, c->A);
 
     return 0; // No extra cycle needed
 }
@@ -861,8 +1111,7 @@ byte ANE(cpu *c) {
     c->A &= cpu_read(c, c->address_bus);
 
     // Set flags
-    cpu_set_flag(c, FLAG_Z, c->A == 0);
-    cpu_set_flag(c, FLAG_N, c->A & 0x80);
+    cpu_set_nz(c, c->A);
 
     return 0; // No extra cycle needed
 }
@@ -874,8 +1123,7 @@ byte ARR(cpu *c) {
 
     // Set Carry, Zero, and Negative flags
     cpu_set_flag(c, FLAG_C, carry);
-    cpu_set_flag(c, FLAG_Z, c->A == 0);
-    cpu_set_flag(c, FLAG_N, c->A & 0x80);
+    cpu_set_nz(c, c->A);
 
     // Set Overflow flag
     cpu_set_flag(c, FLAG_V, ((c->A >> 6) ^ (c->A >> 5)) & 1);
@@ -885,30 +1133,28 @@ byte ARR(cpu *c) {
 
 byte DCP(cpu *c) {
     byte value = cpu_read(c, c->address_bus) - 1;
-    cpu_write(c, c->address_bus, value);
+    cpu_write_operand(c, value);
 
     // Perform CMP A with memory
     byte temp = c->A - value;
 
     // Set flags
     cpu_set_flag(c, FLAG_C, c->A >= value);
-    cpu_set_flag(c, FLAG_Z, temp == 0);
-    cpu_set_flag(c, FLAG_N, temp & 0x80);
+    cpu_set_nz(c, temp);
 
     return 0; // No extra cycle needed
 }
 
 byte ISC(cpu *c) {
     byte value = cpu_read(c, c->address_bus) + 1;
-    cpu_write(c, c->address_bus, value);
+    cpu_write_operand(c, value);
 
     // Perform SBC A with memory
     addr result = (addr)c->A - value - (cpu_get_flag(c, FLAG_C) ? 0 : 1);
 
     // Set flags
     cpu_set_flag(c, FLAG_C, result <= 0xFF);
-    cpu_set_flag(c, FLAG_Z, (result & 0xFF) == 0);
-    cpu_set_flag(c, FLAG_N, result & 0x80);
+    cpu_set_nz(c, result);
     cpu_set_flag(c, FLAG_V, ((c->A ^ result) & (value ^ result) & 0x80));
 
     c->A = result & 0xFF;
@@ -922,8 +1168,7 @@ byte LAS(cpu *c) {
     c->SP = value;
 
     // Set flags
-    cpu_set_flag(c, FLAG_Z, c->A == 0);
-    cpu_set_flag(c, FLAG_N, c->A & 0x80);
+    cpu_set_nz(c, c->A);
 
     return 1; // No extra cycle needed
 }
@@ -933,8 +1178,7 @@ byte LAX(cpu *c) {
     c->X = c->A;
 
     // Set flags
-    cpu_set_flag(c, FLAG_Z, c->A == 0);
-    cpu_set_flag(c, FLAG_N, c->A & 0x80);
+    cpu_set_nz(c, c->A);
 
     return 1; // No extra cycle needed
 }
@@ -946,8 +1190,7 @@ byte LXA(cpu *c) {
     c->X = c->A;
 
     // Set flags
-    cpu_set_flag(c, FLAG_Z, c->A == 0);
-    cpu_set_flag(c, FLAG_N, c->A & 0x80);
+    cpu_set_nz(c, c->A);
 
     return 0; // No extra cycle needed
 }
@@ -958,14 +1201,13 @@ byte RLA(cpu *c) {
     byte new_carry = value & 0x80;
 
     value = (value << 1) | carry;
-    cpu_write(c, c->address_bus, value);
+    cpu_write_operand(c, value);
 
     c->A &= value;
 
     // Set flags
     cpu_set_flag(c, FLAG_C, new_carry);
-    cpu_set_flag(c, FLAG_Z, c->A == 0);
-    cpu_set_flag(c, FLAG_N, c->A & 0x80);
+    cpu_set_nz(c, c->A);
 
     return 0; // No extra cycle needed
 }
@@ -975,15 +1217,14 @@ byte RRA(cpu *c) {
     byte value = cpu_read(c, c->address_bus);
 
     value = (value >> 1) | (carry << 7);
-    cpu_write(c, c->address_bus, value);
+    cpu_write_operand(c, value);
 
     // Perform ADC A with value
     addr result = c->A + value + cpu_get_flag(c, FLAG_C);
 
     // Set flags
     cpu_set_flag(c, FLAG_C, result > 0xFF);
-    cpu_set_flag(c, FLAG_Z, (result & 0xFF) == 0);
-    cpu_set_flag(c, FLAG_N, result & 0x80);
+    cpu_set_nz(c, result);
     cpu_set_flag(c, FLAG_V, (~(c->A ^ value) & (c->A ^ result) & 0x80));
 
     c->A = result & 0xFF;
@@ -991,7 +1232,7 @@ byte RRA(cpu *c) {
 }
 
 byte SAX(cpu *c) {
-    cpu_write(c, c->address_bus, c->A & c->X);
+    cpu_write_operand(c, c->A & c->X);
     return 0; // No extra cycle needed
 }
 
@@ -1001,8 +1242,7 @@ byte SBX(cpu *c) {
 
     // Set flags
     cpu_set_flag(c, FLAG_C, (c->A & c->X) >= value);
-    cpu_set_flag(c, FLAG_Z, temp == 0);
-    cpu_set_flag(c, FLAG_N, temp & 0x80);
+    cpu_set_nz(c, temp);
 
     c->X = temp;
     return 0; // No extra cycle needed
@@ -1010,19 +1250,19 @@ byte SBX(cpu *c) {
 
 byte SHA(cpu *c) {
     byte value = c->A & c->X & ((c->address_bus >> 8) + 1);
-    cpu_write(c, c->address_bus, value);
+    cpu_write_operand(c, value);
     return 0; // No extra cycle needed
 }
 
 byte SHX(cpu *c) {
     byte value = c->X & ((c->address_bus >> 8) + 1);
-    cpu_write(c, c->address_bus, value);
+    cpu_write_operand(c, value);
     return 0; // No extra cycle needed
 }
 
 byte SHY(cpu *c) {
     byte value = c->Y & ((c->address_bus >> 8) + 1);
-    cpu_write(c, c->address_bus, value);
+    cpu_write_operand(c, value);
     return 0; // No extra cycle needed
 }
 
@@ -1031,14 +1271,13 @@ byte SLO(cpu *c) {
     byte carry = value & 0x80;
 
     value <<= 1;
-    cpu_write(c, c->address_bus, value);
+    cpu_write_operand(c, value);
 
     c->A |= value;
 
     // Set flags
     cpu_set_flag(c, FLAG_C, carry);
-    cpu_set_flag(c, FLAG_Z, c->A == 0);
-    cpu_set_flag(c, FLAG_N, c->A & 0x80);
+    cpu_set_nz(c, c->A);
 
     return 0; // No extra cycle needed
 }
@@ -1048,20 +1287,19 @@ byte SRE(cpu *c) {
     byte carry = value & 0x01;
 
     value >>= 1;
-    cpu_write(c, c->address_bus, value);
+    cpu_write_operand(c, value);
 
     c->A ^= value;
 
     // Set flags
     cpu_set_flag(c, FLAG_C, carry);
-    cpu_set_flag(c, FLAG_Z, c->A == 0);
-    cpu_set_flag(c, FLAG_N, c->A & 0x80);
+    cpu_set_nz(c, c->A);
 
     return 0; // No extra cycle needed
 }
 
 byte TAS(cpu *c) {
-    cpu_write(c, c->address_bus, c->SP & ((c->address_bus >> 8) + 1));
+    cpu_write_operand(c, c->SP & ((c->address_bus >> 8) + 1));
     return 0; // No extra cycle needed
 }
 
@@ -1083,449 +1321,29 @@ byte NOP_undoc(cpu *c) {
     return 0; // No extra cycle needed
 }
 
-byte JAM(cpu *c) {
-    // Trap the CPU in an infinite loop to simulate the CPU halt
-    printf("CPU has been JAMMED (halted)\n");
+#endif // CPU_VARIANT_65C02
 
+byte JAM(cpu *c) {
+    // The CPU stops on the opcode until reset, the run loops see c->halted
+    // and leave it to the caller (see board_wait_reset())
     c->data_bus = 0xFF;
-    while (CPU_JAM)
-        ;
-
-    return 0;  // This is unreachable, as the CPU is "stuck"
-}
-
-void cpu_code(cpu *c) {
-    // System Instructions
-    c->code[0x00] = (struct code_t){"BRK", &IMP, &BRK, 7};
-
-    // Load/Store Operations
-    c->code[0xA9] = (struct code_t){"LDA", &IMM, &LDA, 2}; // LDA Immediate
-    c->code[0xA5] = (struct code_t){"LDA", &ZPG, &LDA, 3}; // LDA Zero Page
-    c->code[0xB5] = (struct code_t){"LDA", &ZPX, &LDA, 4}; // LDA Zero Page,X
-    c->code[0xAD] = (struct code_t){"LDA", &ABS, &LDA, 4}; // LDA Absolute
-    c->code[0xBD] = (struct code_t){"LDA", &ABX, &LDA, 4}; // LDA Absolute,X
-    c->code[0xB9] = (struct code_t){"LDA", &ABY, &LDA, 4}; // LDA Absolute,Y
-    c->code[0xA1] = (struct code_t){"LDA", &IZX, &LDA, 6}; // LDA (Indirect,X)
-    c->code[0xB1] = (struct code_t){"LDA", &IZY, &LDA, 5}; // LDA (Indirect),Y
-
-    // LDX (Load X Register)
-    c->code[0xA2] = (struct code_t){"LDX", &IMM, &LDX, 2};
-    c->code[0xA6] = (struct code_t){"LDX", &ZPG, &LDX, 3};
-    c->code[0xB6] = (struct code_t){"LDX", &ZPY, &LDX, 4};
-    c->code[0xAE] = (struct code_t){"LDX", &ABS, &LDX, 4};
-    c->code[0xBE] = (struct code_t){"LDX", &ABY, &LDX, 4};
-
-    // LDY (Load Y Register)
-    c->code[0xA0] = (struct code_t){"LDY", &IMM, &LDY, 2};
-    c->code[0xA4] = (struct code_t){"LDY", &ZPG, &LDY, 3};
-    c->code[0xB4] = (struct code_t){"LDY", &ZPX, &LDY, 4};
-    c->code[0xAC] = (struct code_t){"LDY", &ABS, &LDY, 4};
-    c->code[0xBC] = (struct code_t){"LDY", &ABX, &LDY, 4};
-
-    // ADC Immediate
-    c->code[0x69] = (struct code_t){"ADC", &IMM, &ADC, 2};
-    // ADC Zero Page
-    c->code[0x65] = (struct code_t){"ADC", &ZPG, &ADC, 3};
-    // ADC Zero Page,X
-    c->code[0x75] = (struct code_t){"ADC", &ZPX, &ADC, 4};
-    // ADC Absolute
-    c->code[0x6D] = (struct code_t){"ADC", &ABS, &ADC, 4};
-    // ADC Absolute,X
-    c->code[0x7D] = (struct code_t){"ADC", &ABX, &ADC, 4}; // Note: +1 if page boundary is crossed
-    // ADC Absolute,Y
-    c->code[0x79] = (struct code_t){"ADC", &ABY, &ADC, 4}; // Note: +1 if page boundary is crossed
-    // ADC (Indirect,X)
-    c->code[0x61] = (struct code_t){"ADC", &IZX, &ADC, 6};
-    // ADC (Indirect),Y
-    c->code[0x71] = (struct code_t){"ADC", &IZY, &ADC, 5}; // Note: +1 if page boundary is crossed
-
-    // AND Immediate
-    c->code[0x29] = (struct code_t){"AND", &IMM, &AND, 2};
-    // AND Zero Page
-    c->code[0x25] = (struct code_t){"AND", &ZPG, &AND, 3};
-    // AND Zero Page,X
-    c->code[0x35] = (struct code_t){"AND", &ZPX, &AND, 4};
-    // AND Absolute
-    c->code[0x2D] = (struct code_t){"AND", &ABS, &AND, 4};
-    // AND Absolute,X
-    c->code[0x3D] = (struct code_t){"AND", &ABX, &AND, 4}; // Note: +1 if page boundary is crossed
-    // AND Absolute,Y
-    c->code[0x39] = (struct code_t){"AND", &ABY, &AND, 4}; // Note: +1 if page boundary is crossed
-    // AND (Indirect,X)
-    c->code[0x21] = (struct code_t){"AND", &IZX, &AND, 6};
-    // AND (Indirect),Y
-    c->code[0x31] = (struct code_t){"AND", &IZY, &AND, 5}; // Note: +1 if page boundary is crossed
-
-    // ASL with Accumulator
-    c->code[0x0A] = (struct code_t){"ASL", &ACC, &ASL, 2}; // ASL Accumulator
-    // ASL with Zero Page
-    c->code[0x06] = (struct code_t){"ASL", &ZPG, &ASL, 5}; // ASL Zero Page
-    // ASL with Zero Page,X
-    c->code[0x16] = (struct code_t){"ASL", &ZPX, &ASL, 6}; // ASL Zero Page,X
-    // ASL with Absolute
-    c->code[0x0E] = (struct code_t){"ASL", &ABS, &ASL, 6}; // ASL Absolute
-    // ASL with Absolute,X
-    c->code[0x1E] = (struct code_t){"ASL", &ABX, &ASL, 7}; // ASL Absolute,X (Note: +1 cycle if page boundary is crossed)
-
-
-    c->code[0x90] = (struct code_t){"BCC", &REL, &BCC, 2}; // +1 if branch succeeds, +2 if to a new page
-    c->code[0xB0] = (struct code_t){"BCS", &REL, &BCS, 2}; // +1 if branch succeeds, +2 if to a new page
-    c->code[0xF0] = (struct code_t){"BEQ", &REL, &BEQ, 2}; // +1 if branch succeeds, +2 if to a new page
-
-    c->code[0x24] = (struct code_t){"BIT", &ZPG, &BIT, 3}; // BIT Zero Page
-    c->code[0x2C] = (struct code_t){"BIT", &ABS, &BIT, 4}; // BIT Absolute
-
-    c->code[0x30] = (struct code_t){"BMI", &REL, &BMI, 2}; // +1 if branch succeeds, +2 if to a new page
-
-    c->code[0xD0] = (struct code_t){"BNE", &REL, &BNE, 2}; // +1 if branch succeeds, +2 if to a new page
-
-    c->code[0x10] = (struct code_t){"BPL", &REL, &BPL, 2}; // +1 if branch succeeds, +2 if to a new page
-
-    // BVC (Branch if Overflow Clear)
-    c->code[0x50] = (struct code_t){"BVC", &REL, &BVC, 2}; // BVC Relative
-    // BVS (Branch if Overflow Set)
-    c->code[0x70] = (struct code_t){"BVS", &REL, &BVS, 2}; // BVS Relative
-
-    // CLC (Clear Carry Flag)
-    c->code[0x18] = (struct code_t){"CLC", &IMP, &CLC, 2};
-    // CLD (Clear Decimal Mode)
-    c->code[0xD8] = (struct code_t){"CLD", &IMP, &CLD, 2};
-    // CLI (Clear Interrupt Disable)
-    c->code[0x58] = (struct code_t){"CLI", &IMP, &CLI, 2};
-    // CLV (Clear Overflow Flag)
-    c->code[0xB8] = (struct code_t){"CLV", &IMP, &CLV, 2};
-
-    // CMP (Compare Accumulator)
-    c->code[0xC9] = (struct code_t){"CMP", &IMM, &CMP, 2};
-    c->code[0xC5] = (struct code_t){"CMP", &ZPG, &CMP, 3};
-    c->code[0xD5] = (struct code_t){"CMP", &ZPX, &CMP, 4};
-    c->code[0xCD] = (struct code_t){"CMP", &ABS, &CMP, 4};
-    c->code[0xDD] = (struct code_t){"CMP", &ABX, &CMP, 4};
-    c->code[0xD9] = (struct code_t){"CMP", &ABY, &CMP, 4};
-    c->code[0xC1] = (struct code_t){"CMP", &IZX, &CMP, 6};
-    c->code[0xD1] = (struct code_t){"CMP", &IZY, &CMP, 5};
-
-    // CPX (Compare X Register)
-    c->code[0xE0] = (struct code_t){"CPX", &IMM, &CPX, 2};
-    c->code[0xE4] = (struct code_t){"CPX", &ZPG, &CPX, 3};
-    c->code[0xEC] = (struct code_t){"CPX", &ABS, &CPX, 4};
-
-    // CPY (Compare Y Register)
-    c->code[0xC0] = (struct code_t){"CPY", &IMM, &CPY, 2};
-    c->code[0xC4] = (struct code_t){"CPY", &ZPG, &CPY, 3};
-    c->code[0xCC] = (struct code_t){"CPY", &ABS, &CPY, 4};
-
-    // DEC (Decrement Memory)
-    c->code[0xC6] = (struct code_t){"DEC", &ZPG, &DEC, 5};
-    c->code[0xD6] = (struct code_t){"DEC", &ZPX, &DEC, 6};
-    c->code[0xCE] = (struct code_t){"DEC", &ABS, &DEC, 6};
-    c->code[0xDE] = (struct code_t){"DEC", &ABX, &DEC, 7};
-
-    // DEX (Decrement X Register)
-    c->code[0xCA] = (struct code_t){"DEX", &IMP, &DEX, 2};
-
-    // DEY (Decrement Y Register)
-    c->code[0x88] = (struct code_t){"DEY", &IMP, &DEY, 2};
-
-    // EOR (Exclusive OR)
-    c->code[0x49] = (struct code_t){"EOR", &IMM, &EOR, 2};
-    c->code[0x45] = (struct code_t){"EOR", &ZPG, &EOR, 3};
-    c->code[0x55] = (struct code_t){"EOR", &ZPX, &EOR, 4};
-    c->code[0x4D] = (struct code_t){"EOR", &ABS, &EOR, 4};
-    c->code[0x5D] = (struct code_t){"EOR", &ABX, &EOR, 4};
-    c->code[0x59] = (struct code_t){"EOR", &ABY, &EOR, 4};
-    c->code[0x41] = (struct code_t){"EOR", &IZX, &EOR, 6};
-    c->code[0x51] = (struct code_t){"EOR", &IZY, &EOR, 5};
-
-    // INC (Increment Memory)
-    c->code[0xE6] = (struct code_t){"INC", &ZPG, &INC, 5};
-    c->code[0xF6] = (struct code_t){"INC", &ZPX, &INC, 6};
-    c->code[0xEE] = (struct code_t){"INC", &ABS, &INC, 6};
-    c->code[0xFE] = (struct code_t){"INC", &ABX, &INC, 7};
-
-    // INX (Increment X Register)
-    c->code[0xE8] = (struct code_t){"INX", &IMP, &INX, 2};
-
-    // INY (Increment Y Register)
-    c->code[0xC8] = (struct code_t){"INY", &IMP, &INY, 2};
-
-    // JMP (Jump)
-    c->code[0x4C] = (struct code_t){"JMP", &ABS, &JMP, 3}; // Absolute jump
-    c->code[0x6C] = (struct code_t){"JMP", &IND, &JMP, 5}; // Indirect jump
-
-    // JSR (Jump to Subroutine)
-    c->code[0x20] = (struct code_t){"JSR", &ABS, &JSR, 6};
-
-
-    // LSR (Logical Shift Right)
-    c->code[0x4A] = (struct code_t){"LSR", &ACC, &LSR, 2}; // Accumulator
-    c->code[0x46] = (struct code_t){"LSR", &ZPG, &LSR, 5}; // Zero Page
-    c->code[0x56] = (struct code_t){"LSR", &ZPX, &LSR, 6}; // Zero Page,X
-    c->code[0x4E] = (struct code_t){"LSR", &ABS, &LSR, 6}; // Absolute
-    c->code[0x5E] = (struct code_t){"LSR", &ABX, &LSR, 7}; // Absolute,X
-
-    // NOP (No Operation)
-    c->code[0xEA] = (struct code_t){"NOP", &IMP, &NOP, 2};
-
-    // ORA (Logical Inclusive OR)
-    c->code[0x09] = (struct code_t){"ORA", &IMM, &ORA, 2};
-    c->code[0x05] = (struct code_t){"ORA", &ZPG, &ORA, 3};
-    c->code[0x15] = (struct code_t){"ORA", &ZPX, &ORA, 4};
-    c->code[0x0D] = (struct code_t){"ORA", &ABS, &ORA, 4};
-    c->code[0x1D] = (struct code_t){"ORA", &ABX, &ORA, 4};
-    c->code[0x19] = (struct code_t){"ORA", &ABY, &ORA, 4};
-    c->code[0x01] = (struct code_t){"ORA", &IZX, &ORA, 6};
-    c->code[0x11] = (struct code_t){"ORA", &IZY, &ORA, 5};
-
-    // PHA (Push Accumulator)
-    c->code[0x48] = (struct code_t){"PHA", &IMP, &PHA, 3};
-
-    // PHP (Push Processor Status)
-    c->code[0x08] = (struct code_t){"PHP", &IMP, &PHP, 3};
-
-    // PLA (Pull Accumulator)
-    c->code[0x68] = (struct code_t){"PLA", &IMP, &PLA, 4};
-
-    // PLP (Pull Processor Status)
-    c->code[0x28] = (struct code_t){"PLP", &IMP, &PLP, 4};
-
-    // ROL (Rotate Left)
-    c->code[0x2A] = (struct code_t){"ROL", &ACC, &ROL, 2}; // Accumulator
-    c->code[0x26] = (struct code_t){"ROL", &ZPG, &ROL, 5}; // Zero Page
-    c->code[0x36] = (struct code_t){"ROL", &ZPX, &ROL, 6}; // Zero Page,X
-    c->code[0x2E] = (struct code_t){"ROL", &ABS, &ROL, 6}; // Absolute
-    c->code[0x3E] = (struct code_t){"ROL", &ABX, &ROL, 7}; // Absolute,X
-
-    // ROR (Rotate Right)
-    c->code[0x6A] = (struct code_t){"ROR", &ACC, &ROR, 2}; // Accumulator
-    c->code[0x66] = (struct code_t){"ROR", &ZPG, &ROR, 5}; // Zero Page
-    c->code[0x76] = (struct code_t){"ROR", &ZPX, &ROR, 6}; // Zero Page,X
-    c->code[0x6E] = (struct code_t){"ROR", &ABS, &ROR, 6}; // Absolute
-    c->code[0x7E] = (struct code_t){"ROR", &ABX, &ROR, 7}; // Absolute,X
-
-    // RTI (Return from Interrupt)
-    c->code[0x40] = (struct code_t){"RTI", &IMP, &RTI, 6};
-
-    // RTS (Return from Subroutine)
-    c->code[0x60] = (struct code_t){"RTS", &IMP, &RTS, 6};
-
-    // SBC (Subtract with Carry)
-    c->code[0xE9] = (struct code_t){"SBC", &IMM, &SBC, 2}; // Immediate
-    c->code[0xE5] = (struct code_t){"SBC", &ZPG, &SBC, 3}; // Zero Page
-    c->code[0xF5] = (struct code_t){"SBC", &ZPX, &SBC, 4}; // Zero Page,X
-    c->code[0xED] = (struct code_t){"SBC", &ABS, &SBC, 4}; // Absolute
-    c->code[0xFD] = (struct code_t){"SBC", &ABX, &SBC, 4}; // Absolute,X
-    c->code[0xF9] = (struct code_t){"SBC", &ABY, &SBC, 4}; // Absolute,Y
-    c->code[0xE1] = (struct code_t){"SBC", &IZX, &SBC, 6}; // (Indirect,X)
-    c->code[0xF1] = (struct code_t){"SBC", &IZY, &SBC, 5}; // (Indirect),Y
-
-    // SEC (Set Carry Flag)
-    c->code[0x38] = (struct code_t){"SEC", &IMP, &SEC, 2};
-
-    // SED (Set Decimal Flag)
-    c->code[0xF8] = (struct code_t){"SED", &IMP, &SED, 2};
-
-    // SEI (Set Interrupt Disable)
-    c->code[0x78] = (struct code_t){"SEI", &IMP, &SEI, 2};
-
-    // STA (Store Accumulator)
-    c->code[0x85] = (struct code_t){"STA", &ZPG, &STA, 3}; // Zero Page
-    c->code[0x95] = (struct code_t){"STA", &ZPX, &STA, 4}; // Zero Page,X
-    c->code[0x8D] = (struct code_t){"STA", &ABS, &STA, 4}; // Absolute
-    c->code[0x9D] = (struct code_t){"STA", &ABX, &STA, 5}; // Absolute,X
-    c->code[0x99] = (struct code_t){"STA", &ABY, &STA, 5}; // Absolute,Y
-    c->code[0x81] = (struct code_t){"STA", &IZX, &STA, 6}; // (Indirect,X)
-    c->code[0x91] = (struct code_t){"STA", &IZY, &STA, 6}; // (Indirect),Y
-
-    // STX (Store X Register)
-    c->code[0x86] = (struct code_t){"STX", &ZPG, &STX, 3}; // Zero Page
-    c->code[0x96] = (struct code_t){"STX", &ZPY, &STX, 4}; // Zero Page,Y
-    c->code[0x8E] = (struct code_t){"STX", &ABS, &STX, 4}; // Absolute
-
-    // STY (Store Y Register)
-    c->code[0x84] = (struct code_t){"STY", &ZPG, &STY, 3}; // Zero Page
-    c->code[0x94] = (struct code_t){"STY", &ZPX, &STY, 4}; // Zero Page,X
-    c->code[0x8C] = (struct code_t){"STY", &ABS, &STY, 4}; // Absolute
-
-    // TAX (Transfer Accumulator to X)
-    c->code[0xAA] = (struct code_t){"TAX", &IMP, &TAX, 2};
-
-    // TAY (Transfer Accumulator to Y)
-    c->code[0xA8] = (struct code_t){"TAY", &IMP, &TAY, 2};
-
-    // TSX (Transfer Stack Pointer to X)
-    c->code[0xBA] = (struct code_t){"TSX", &IMP, &TSX, 2};
-
-    // TXA (Transfer X to Accumulator)
-    c->code[0x8A] = (struct code_t){"TXA", &IMP, &TXA, 2};
-
-    // TXS (Transfer X to Stack Pointer)
-    c->code[0x9A] = (struct code_t){"TXS", &IMP, &TXS, 2};
-
-    // TYA (Transfer Y to Accumulator)
-    c->code[0x98] = (struct code_t){"TYA", &IMP, &TYA, 2};
-
-    //////////////////////////////////////////////////////
-    // ILLEGAL OPCODES                                  //
-    //////////////////////////////////////////////////////
-
-    // ALR - AND byte with accumulator, then LSR A
-    c->code[0x4B] = (struct code_t){"ALR", &IMM, &ALR, 2};
-
-    // ANC - AND byte with accumulator, then copy bit 7 of A into C
-    c->code[0x0B] = (struct code_t){"ANC", &IMM, &ANC, 2};
-    c->code[0x2B] = (struct code_t){"ANC", &IMM, &ANC, 2};
-
-    // ANE - AND X register with accumulator and an immediate value, then store the result in A (unstable)
-    c->code[0x8B] = (struct code_t){"ANE", &IMM, &ANE, 2};
-
-    // ARR - AND byte with accumulator, then rotate one bit right in the accumulator, and check bit 5 and 6 to set flags
-    c->code[0x6B] = (struct code_t){"ARR", &IMM, &ARR, 2};
-
-    // DCP - Decrement memory by one, then compare memory with accumulator
-    c->code[0xC7] = (struct code_t){"DCP", &ZPG, &DCP, 5};
-    c->code[0xD7] = (struct code_t){"DCP", &ZPX, &DCP, 6};
-    c->code[0xCF] = (struct code_t){"DCP", &ABS, &DCP, 6};
-    c->code[0xDF] = (struct code_t){"DCP", &ABX, &DCP, 7};
-    c->code[0xDB] = (struct code_t){"DCP", &ABY, &DCP, 7};
-    c->code[0xC3] = (struct code_t){"DCP", &IZX, &DCP, 8};
-    c->code[0xD3] = (struct code_t){"DCP", &IZY, &DCP, 8};
-
-    // ISC - Increase memory by one, then subtract memory from accumulator (with carry)
-    c->code[0xE7] = (struct code_t){"ISC", &ZPG, &ISC, 5};
-    c->code[0xF7] = (struct code_t){"ISC", &ZPX, &ISC, 6};
-    c->code[0xEF] = (struct code_t){"ISC", &ABS, &ISC, 6};
-    c->code[0xFF] = (struct code_t){"ISC", &ABX, &ISC, 7};
-    c->code[0xFB] = (struct code_t){"ISC", &ABY, &ISC, 7};
-    c->code[0xE3] = (struct code_t){"ISC", &IZX, &ISC, 8};
-    c->code[0xF3] = (struct code_t){"ISC", &IZY, &ISC, 8};
-
-    // LAS - Load accumulator and stack pointer with AND of stack pointer and memory
-    c->code[0xBB] = (struct code_t){"LAS", &ABY, &LAS, 4};
-
-    // LAX - Load accumulator and X register with memory
-    c->code[0xA7] = (struct code_t){"LAX", &ZPG, &LAX, 3};
-    c->code[0xB7] = (struct code_t){"LAX", &ZPY, &LAX, 4};
-    c->code[0xAF] = (struct code_t){"LAX", &ABS, &LAX, 4};
-    c->code[0xBF] = (struct code_t){"LAX", &ABY, &LAX, 4};
-    c->code[0xA3] = (struct code_t){"LAX", &IZX, &LAX, 6};
-    c->code[0xB3] = (struct code_t){"LAX", &IZY, &LAX, 5};
-
-    // LXA - Illegal opcode, behaves similarly to LAX
-    c->code[0xAB] = (struct code_t){"LXA", &IMM, &LXA, 2};
-
-    // RLA - Rotate one bit left in memory, then AND accumulator with memory
-    c->code[0x27] = (struct code_t){"RLA", &ZPG, &RLA, 5};
-    c->code[0x37] = (struct code_t){"RLA", &ZPX, &RLA, 6};
-    c->code[0x2F] = (struct code_t){"RLA", &ABS, &RLA, 6};
-    c->code[0x3F] = (struct code_t){"RLA", &ABX, &RLA, 7};
-    c->code[0x3B] = (struct code_t){"RLA", &ABY, &RLA, 7};
-    c->code[0x23] = (struct code_t){"RLA", &IZX, &RLA, 8};
-    c->code[0x33] = (struct code_t){"RLA", &IZY, &RLA, 8};
-
-    // RRA - Rotate one bit right in memory, then add memory to accumulator with carry
-    c->code[0x67] = (struct code_t){"RRA", &ZPG, &RRA, 5};
-    c->code[0x77] = (struct code_t){"RRA", &ZPX, &RRA, 6};
-    c->code[0x6F] = (struct code_t){"RRA", &ABS, &RRA, 6};
-    c->code[0x7F] = (struct code_t){"RRA", &ABX, &RRA, 7};
-    c->code[0x7B] = (struct code_t){"RRA", &ABY, &RRA, 7};
-    c->code[0x63] = (struct code_t){"RRA", &IZX, &RRA, 8};
-    c->code[0x73] = (struct code_t){"RRA", &IZY, &RRA, 8};
-
-    // SAX - Store A AND X
-    c->code[0x87] = (struct code_t){"SAX", &ZPG, &SAX, 3};
-    c->code[0x97] = (struct code_t){"SAX", &ZPY, &SAX, 4};
-    c->code[0x8F] = (struct code_t){"SAX", &ABS, &SAX, 4};
-    c->code[0x83] = (struct code_t){"SAX", &IZX, &SAX, 6};
-
-    // SBX - Subtract memory from A and X (AND X with A, then subtract memory from result)
-    c->code[0xCB] = (struct code_t){"SBX", &IMM, &SBX, 2};
-
-    // SHA - Store A AND X AND the high byte of the target address plus one
-    c->code[0x9F] = (struct code_t){"SHA", &ABY, &SHA, 5};
-    c->code[0x93] = (struct code_t){"SHA", &IZY, &SHA, 6};
-
-    // SHX - Store X AND the high byte of the target address plus one
-    c->code[0x9E] = (struct code_t){"SHX", &ABY, &SHX, 5};
-
-    // SHY - Store Y AND the high byte of the target address plus one
-    c->code[0x9C] = (struct code_t){"SHY", &ABX, &SHY, 5};
-
-    // SLO - Shift Left then OR (Unofficial opcode)
-    c->code[0x07] = (struct code_t){"SLO", &ZPG, &SLO, 5};
-    c->code[0x17] = (struct code_t){"SLO", &ZPX, &SLO, 6};
-    c->code[0x0F] = (struct code_t){"SLO", &ABS, &SLO, 6};
-    c->code[0x1F] = (struct code_t){"SLO", &ABX, &SLO, 7};
-    c->code[0x1B] = (struct code_t){"SLO", &ABY, &SLO, 7};
-    c->code[0x03] = (struct code_t){"SLO", &IZX, &SLO, 8};
-    c->code[0x13] = (struct code_t){"SLO", &IZY, &SLO, 8};
-
-    // SRE - Shift Right then Exclusive OR (Unofficial opcode)
-    c->code[0x47] = (struct code_t){"SRE", &ZPG, &SRE, 5};
-    c->code[0x57] = (struct code_t){"SRE", &ZPX, &SRE, 6};
-    c->code[0x4F] = (struct code_t){"SRE", &ABS, &SRE, 6};
-    c->code[0x5F] = (struct code_t){"SRE", &ABX, &SRE, 7};
-    c->code[0x5B] = (struct code_t){"SRE", &ABY, &SRE, 7};
-    c->code[0x43] = (struct code_t){"SRE", &IZX, &SRE, 8};
-    c->code[0x53] = (struct code_t){"SRE", &IZY, &SRE, 8};
-
-    // TAS - AND X register with A and store result in stack pointer, then AND stack pointer with the high byte of the target address of the argument + 1. Store the result in memory. (Unofficial opcode)
-    c->code[0x9B] = (struct code_t){"TAS", &ABY, &TAS, 5};
-
-    // USBC - Unofficial opcode, often acts like SBC (Subtract with Carry)
-    c->code[0xEB] = (struct code_t){"SBC", &IMM, &USBC, 2}; // Example using IMM addressing, actual behavior may vary
-
-    // NOP_undoc - Undocumented No Operation variants with different cycles or addressing modes
-    // NOPs (No Operation) - Implied
-    c->code[0x1A] = (struct code_t){"NOP", &IMP, &NOP_undoc, 2};
-    c->code[0x3A] = (struct code_t){"NOP", &IMP, &NOP_undoc, 2};
-    c->code[0x5A] = (struct code_t){"NOP", &IMP, &NOP_undoc, 2};
-    c->code[0x7A] = (struct code_t){"NOP", &IMP, &NOP_undoc, 2};
-    c->code[0xDA] = (struct code_t){"NOP", &IMP, &NOP_undoc, 2};
-    c->code[0xFA] = (struct code_t){"NOP", &IMP, &NOP_undoc, 2};
-
-    // NOPs (No Operation) - Immediate
-    c->code[0x80] = (struct code_t){"NOP", &IMM, &NOP_undoc, 2};
-    c->code[0x82] = (struct code_t){"NOP", &IMM, &NOP_undoc, 2};
-    c->code[0x89] = (struct code_t){"NOP", &IMM, &NOP_undoc, 2};
-    c->code[0xC2] = (struct code_t){"NOP", &IMM, &NOP_undoc, 2};
-    c->code[0xE2] = (struct code_t){"NOP", &IMM, &NOP_undoc, 2};
-
-    // NOPs (No Operation) - Zero Page
-    c->code[0x04] = (struct code_t){"NOP", &ZPG, &NOP_undoc, 3};
-    c->code[0x44] = (struct code_t){"NOP", &ZPG, &NOP_undoc, 3};
-    c->code[0x64] = (struct code_t){"NOP", &ZPG, &NOP_undoc, 3};
-
-    // NOPs (No Operation) - Zero Page,X
-    c->code[0x14] = (struct code_t){"NOP", &ZPX, &NOP_undoc, 4};
-    c->code[0x34] = (struct code_t){"NOP", &ZPX, &NOP_undoc, 4};
-    c->code[0x54] = (struct code_t){"NOP", &ZPX, &NOP_undoc, 4};
-    c->code[0x74] = (struct code_t){"NOP", &ZPX, &NOP_undoc, 4};
-    c->code[0xD4] = (struct code_t){"NOP", &ZPX, &NOP_undoc, 4};
-    c->code[0xF4] = (struct code_t){"NOP", &ZPX, &NOP_undoc, 4};
-
-    // NOPs (No Operation) - Absolute
-    c->code[0x0C] = (struct code_t){"NOP", &ABS, &NOP_undoc, 4};
-
-    // NOPs (No Operation) - Absolute,X
-    c->code[0x1C] = (struct code_t){"NOP", &ABX, &NOP_undoc, 4}; // Page boundary crossed cycles may vary
-    c->code[0x3C] = (struct code_t){"NOP", &ABX, &NOP_undoc, 4}; // Page boundary crossed cycles may vary
-    c->code[0x5C] = (struct code_t){"NOP", &ABX, &NOP_undoc, 4}; // Page boundary crossed cycles may vary
-    c->code[0x7C] = (struct code_t){"NOP", &ABX, &NOP_undoc, 4}; // Page boundary crossed cycles may vary
-    c->code[0xDC] = (struct code_t){"NOP", &ABX, &NOP_undoc, 4}; // Page boundary crossed cycles may vary
-    c->code[0xFC] = (struct code_t){"NOP", &ABX, &NOP_undoc, 4}; // Page boundary crossed cycles may vary
-
-    // JAM (or KIL) - Causes the CPU to halt and do nothing until a reset occurs
-    c->code[0x02] = (struct code_t){"JAM", &IMP, &JAM, 0}; // Cycle count is often irrelevant as the CPU halts
-    c->code[0x12] = (struct code_t){"JAM", &IMP, &JAM, 0};
-    c->code[0x22] = (struct code_t){"JAM", &IMP, &JAM, 0};
-    c->code[0x32] = (struct code_t){"JAM", &IMP, &JAM, 0};
-    c->code[0x42] = (struct code_t){"JAM", &IMP, &JAM, 0};
-    c->code[0x52] = (struct code_t){"JAM", &IMP, &JAM, 0};
-    c->code[0x62] = (struct code_t){"JAM", &IMP, &JAM, 0};
-    c->code[0x72] = (struct code_t){"JAM", &IMP, &JAM, 0};
-    c->code[0x92] = (struct code_t){"JAM", &IMP, &JAM, 0};
-    c->code[0xB2] = (struct code_t){"JAM", &IMP, &JAM, 0};
-    c->code[0xD2] = (struct code_t){"JAM", &IMP, &JAM, 0};
-    c->code[0xF2] = (struct code_t){"JAM", &IMP, &JAM, 0};
+    c->PC--;
+    c->halted = true;
+    return 0;
+}
+
+#ifdef CPU_ILLEGAL_TRAP
+byte TRAP(cpu *c) {
+    // stopped on the opcode like JAM, the caller reports it
+    c->PC--;
+    board_fault(c->bc, ILLEGAL_OPCODE, c->PC);
+    return 0;
 }
+#endif // CPU_ILLEGAL_TRAP
+
+// Decode table shared by every cpu, built at compile time
+const struct code_t cpu_code_table[0x0100] = {
+#define OPCODE(op, str, mode, fn, cyc) [op] = {str, &mode, &fn, cyc},
+#include "./opcodes.def"
+#undef OPCODE
+};
@@ -3,7 +3,14 @@
 
 #include "./arch.h"
 
-#define CPU_JAM 1 // THIS IS ALWAYS 1
+// chip emulated, picked at build time with make VARIANT=nmos|2a03|65c02
+#if defined(CPU_VARIANT_2A03)
+#define CPU_VARIANT "2A03"
+#elif defined(CPU_VARIANT_65C02)
+#define CPU_VARIANT "65C02"
+#else
+#define CPU_VARIANT "NMOS 6502"
+#endif
 
 // interrupt vectors
 #define NMI 0xFFFA // 0xFFFB
@@ -21,11 +28,21 @@
 #define FLAG_N 0x80  // Negative flag
 
 typedef struct Board Board;
+struct cpu;
+
+// decode table entry
+struct code_t {
+    const char *str;
+    byte (*addressing_mode)(struct cpu *c);
+    byte (*opcode)(struct cpu *c);
+    byte cycles;
+};
 
 // 8-BIT CPU
+// cache line aligned, the decode table lives in cpu_code_table
 typedef struct cpu {
     // connection to motherboard
-    Board *bc;
+    _Alignas(64) Board *bc;
     
     byte IR;       // instruction register
     byte A;        // accumulator
@@ -34,7 +51,7 @@ typedef struct cpu {
                    // I know that all 1 byte register are written with one letter
                    // but technically this refers to $0100 + the stack pointer!
                    // so it's 2 bytes
-    byte P;
+    byte P;        // with CPU_LAZY_FLAGS N, Z, C and V live below, see cpu_get_P()
     word PC; // program counter
 
     byte cycles; // internal cycles
@@ -47,33 +64,148 @@ typedef struct cpu {
     addr address_relative;
     byte data_bus;
 
-    struct code_t {
-        char *str;
-        byte (*addressing_mode)(struct cpu *c);
-        byte (*opcode)(struct cpu *c);
-        byte cycles;
-    } code[0x0100];
+    // jammed by JAM/KIL, PC and IR hold it, only cpu_reset() clears it
+    bool halted;
+
+#ifdef CPU_LAZY_FLAGS
+    // what the last instruction to set each flag left, turned into P bits
+    // only when P is read
+    byte nr;    // N is bit 7
+    byte zr;    // Z is set when zero
+    byte carry; // C, 0 or 1
+    byte ovf;   // V is bit 7
+#endif // CPU_LAZY_FLAGS
 } cpu;
 
+extern const struct code_t cpu_code_table[0x0100];
+
+// runs one opcode from an operand fetched at decode time, PC already advanced,
+// and returns its cycle cost
+typedef byte (*cpu_exec_t)(struct cpu *c, word operand);
+extern const cpu_exec_t cpu_exec_table[0x0100];
+
+// superinstruction from fused.def: runs `count` decoded instructions of a
+// block back to back, ops[i].IR == IR[i], and returns their cycles
+struct BlockOp;
+typedef struct cpu_fused_t {
+    byte IR[3];
+    byte count;
+    byte (*run)(struct cpu *c, const struct BlockOp *ops);
+} cpu_fused_t;
+// entry 0 is none
+extern const cpu_fused_t cpu_fused_table[];
+extern const byte cpu_fused_count;
+
 // memory operations
 byte cpu_read(cpu *c, addr address);
 void cpu_write(cpu *c, addr address, byte data);
 
-// cpu state
-void cpu_set_flag(cpu *c, byte flag, bool condition);
-byte cpu_get_flag(cpu *c, byte flag);
+// cpu state, flag is one of the FLAG_ constants
+static inline void cpu_set_flag(cpu *c, byte flag, bool condition) {
+#ifdef CPU_LAZY_FLAGS
+    switch (flag) {
+    case FLAG_N: c->nr = condition ? 0x80 : 0; return;
+    case FLAG_Z: c->zr = !condition; return;
+    case FLAG_C: c->carry = condition; return;
+    case FLAG_V: c->ovf = condition ? 0x80 : 0; return;
+    }
+#endif // CPU_LAZY_FLAGS
+    if (condition) {
+        c->P |= flag;
+    } else {
+        c->P &= ~flag;
+    }
+}
+
+static inline byte cpu_get_flag(const cpu *c, byte flag) {
+#ifdef CPU_LAZY_FLAGS
+    switch (flag) {
+    case FLAG_N: return c->nr >> 7;
+    case FLAG_Z: return c->zr == 0;
+    case FLAG_C: return c->carry;
+    case FLAG_V: return c->ovf >> 7;
+    }
+#endif // CPU_LAZY_FLAGS
+    return (c->P & flag) ? 1 : 0;
+}
+
+// N and Z from a result, the most common flag update
+static inline void cpu_set_nz(cpu *c, byte value) {
+#ifdef CPU_LAZY_FLAGS
+    c->nr = value;
+    c->zr = value;
+#else
+    c->P = (c->P & ~(FLAG_N | FLAG_Z)) | (value & FLAG_N) | (value == 0 ? FLAG_Z : 0);
+#endif // CPU_LAZY_FLAGS
+}
+
+// Flags in mask taken from the matching bits of flags
+static inline void cpu_set_flags(cpu *c, byte mask, byte flags) {
+#ifdef CPU_LAZY_FLAGS
+    if (mask & FLAG_N) {
+        c->nr = flags;
+    }
+    if (mask & FLAG_Z) {
+        c->zr = !(flags & FLAG_Z);
+    }
+    if (mask & FLAG_C) {
+        c->carry = flags & FLAG_C;
+    }
+    if (mask & FLAG_V) {
+        c->ovf = flags << 1;
+    }
+    mask &= ~(FLAG_N | FLAG_Z | FLAG_C | FLAG_V);
+#endif // CPU_LAZY_FLAGS
+    c->P = (c->P & ~mask) | (flags & mask);
+}
+
+// The whole status register, for pushes, transfers and anything outside
+// the cpu (c->P alone misses N, Z, C and V with CPU_LAZY_FLAGS)
+static inline byte cpu_get_P(const cpu *c) {
+#ifdef CPU_LAZY_FLAGS
+    return (c->P & ~(FLAG_N | FLAG_Z | FLAG_C | FLAG_V)) | (c->nr & FLAG_N)
+        | (c->zr == 0 ? FLAG_Z : 0) | c->carry | ((c->ovf & 0x80) >> 1);
+#else
+    return c->P;
+#endif // CPU_LAZY_FLAGS
+}
+
+static inline void cpu_set_P(cpu *c, byte P) {
+    c->P = P;
+#ifdef CPU_LAZY_FLAGS
+    c->nr = P;
+    c->zr = !(P & FLAG_Z);
+    c->carry = P & FLAG_C;
+    c->ovf = P << 1;
+#endif // CPU_LAZY_FLAGS
+}
 
-cpu *cpu_init(void);
-void cpu_shutdown(cpu *c);
+// Power-on state, in place (the cpu lives inside its Board)
+void cpu_init(cpu *c);
 
-void cpu_clock(cpu *c);
-bool cpu_done(cpu *c);
+// runs one whole instruction and returns its cycle cost, through the core
+// picked at build time (make CORE=table|switch), 0 once halted
+byte cpu_step(cpu *c);
+byte cpu_step_table(cpu *c);
+byte cpu_step_switch(cpu *c);
+// runs c->IR from an operand fetched at decode time, PC already advanced
+byte cpu_step_decoded(cpu *c, word operand);
+// Runs whole instructions with the registers held in locals until `budget`
+// cycles have run, a scheduled event is due or an interrupt is, and returns
+// the cycles run, 0 if an interrupt was due on entry (see cpu_step())
+uint32_t cpu_run(cpu *c, uint32_t budget);
+// ENGINE_BATCH step: cpu_run() for about CPU_BATCH_STEP_CYCLES, or cpu_step()
+// when an interrupt is due
+#define CPU_BATCH_STEP_CYCLES 96
+byte cpu_step_batch(cpu *c);
 
 void cpu_nmi(cpu *c);
 void cpu_reset(cpu *c);
 void cpu_irq(cpu *c);
+// services a pending NMI or unmasked IRQ and returns its cycles, 0 if none
+// or if the cpu is halted
+byte cpu_interrupt(cpu *c);
 
-void cpu_code(cpu *c);
 byte cpu_decode(cpu *c);
 
 // ADDRESSING MODES
@@ -90,6 +222,10 @@ byte IND(cpu *c);
 byte IZY(cpu *c);
 byte IZX(cpu *c);
 byte REL(cpu *c);
+#ifdef CPU_VARIANT_65C02
+byte ZPI(cpu *c);
+byte IAX(cpu *c);
+#endif // CPU_VARIANT_65C02
 
 // LEGAL OPCODES
 byte ADC(cpu *c);
@@ -149,6 +285,20 @@ byte TXA(cpu *c);
 byte TXS(cpu *c);
 byte TYA(cpu *c);
 
+#ifdef CPU_VARIANT_65C02
+// 65C02 OPCODES
+byte BRA(cpu *c);
+byte BIT_imm(cpu *c);
+byte INA(cpu *c);
+byte DEA(cpu *c);
+byte PHX(cpu *c);
+byte PLX(cpu *c);
+byte PHY(cpu *c);
+byte PLY(cpu *c);
+byte STZ(cpu *c);
+byte TRB(cpu *c);
+byte TSB(cpu *c);
+#else
 // ILLEGAL OPCODES
 byte ALR(cpu *c);
 byte ANC(cpu *c);
@@ -171,6 +321,11 @@ byte SRE(cpu *c);
 byte TAS(cpu *c);
 byte USBC(cpu *c);
 byte NOP_undoc(cpu *c);
+#endif // CPU_VARIANT_65C02
 byte JAM (cpu *c);
+#ifdef CPU_ILLEGAL_TRAP
+// stands in for every undocumented opcode with make ILLEGAL=trap
+byte TRAP(cpu *c);
+#endif // CPU_ILLEGAL_TRAP
 
 #endif // !CPU_H_
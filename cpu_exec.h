@@ -0,0 +1,123 @@
+#ifndef CPU_EXEC_H_
+#define CPU_EXEC_H_
+
+#include "./board.h"
+
+// Addressing modes from an operand fetched ahead of time, with c->PC already
+// past the instruction
+
+static inline byte IMP_resolve(cpu *c, word operand) {
+    UNUSED(operand);
+    return IMP(c);
+}
+
+static inline byte ACC_resolve(cpu *c, word operand) {
+    UNUSED(operand);
+    return ACC(c);
+}
+
+static inline byte IMM_resolve(cpu *c, word operand) {
+    c->address_bus = operand;
+    return 0;
+}
+
+static inline byte ZPG_resolve(cpu *c, word operand) {
+    c->address_bus = operand & 0x00FF;
+    return 0;
+}
+
+static inline byte ZPX_resolve(cpu *c, word operand) {
+    c->address_bus = (operand + c->X) & 0x00FF;
+    return 0;
+}
+
+static inline byte ZPY_resolve(cpu *c, word operand) {
+    c->address_bus = (operand + c->Y) & 0x00FF;
+    return 0;
+}
+
+static inline byte ABS_resolve(cpu *c, word operand) {
+    c->address_bus = operand;
+    return 0;
+}
+
+static inline byte ABX_resolve(cpu *c, word operand) {
+    c->address_bus = operand + c->X;
+    return (c->address_bus & 0xFF00) != (operand & 0xFF00);
+}
+
+static inline byte ABY_resolve(cpu *c, word operand) {
+    c->address_bus = operand + c->Y;
+    return (c->address_bus & 0xFF00) != (operand & 0xFF00);
+}
+
+static inline byte IND_resolve(cpu *c, word operand) {
+    addr ptr = operand;
+#ifdef CPU_VARIANT_65C02
+    c->address_bus = (cpu_read(c, ptr + 1) << 8) | cpu_read(c, ptr);
+#else
+    // Handle page boundary bug
+    if ((ptr & 0x00FF) == 0x00FF) {
+        c->address_bus = (cpu_read(c, ptr & 0xFF00) << 8) | cpu_read(c, ptr);
+    } else {
+        c->address_bus = (cpu_read(c, ptr + 1) << 8) | cpu_read(c, ptr);
+    }
+#endif // CPU_VARIANT_65C02
+    return 0;
+}
+
+static inline byte IZY_resolve(cpu *c, word operand) {
+    addr lo = board_read_zp(c->bc, operand);
+    addr hi = board_read_zp(c->bc, operand + 1);
+    c->address_bus = ((hi << 8) | lo) + c->Y;
+    return (c->address_bus & 0xFF00) != (hi << 8);
+}
+
+static inline byte IZX_resolve(cpu *c, word operand) {
+    addr lo = board_read_zp(c->bc, operand + c->X);
+    addr hi = board_read_zp(c->bc, operand + c->X + 1);
+    c->address_bus = (hi << 8) | lo;
+    return 0;
+}
+
+static inline byte REL_resolve(cpu *c, word operand) {
+    c->address_relative = operand;
+    if (c->address_relative & 0x80)
+        c->address_relative |= 0xFF00;
+    return 0;
+}
+
+#ifdef CPU_VARIANT_65C02
+static inline byte ZPI_resolve(cpu *c, word operand) {
+    addr lo = board_read_zp(c->bc, operand);
+    addr hi = board_read_zp(c->bc, operand + 1);
+    c->address_bus = (hi << 8) | lo;
+    return 0;
+}
+
+static inline byte IAX_resolve(cpu *c, word operand) {
+    addr ptr = operand + c->X;
+    c->address_bus = (cpu_read(c, ptr + 1) << 8) | cpu_read(c, ptr);
+    return 0;
+}
+#endif // CPU_VARIANT_65C02
+
+// One handler per opcode, cpu_exec_0xNN(): what cpu_step() runs for that
+// opcode once it has fetched the operand. cpu_exec_table holds their
+// addresses, recompiled ROMs call them directly (see recomp.c).
+#define OPCODE(op, str, mode, fn, cyc)                          \
+    static inline byte cpu_exec_##op(cpu *c, word operand) {    \
+        c->P |= FLAG_U;                                         \
+        c->cycles = cyc;                                        \
+        byte cycle1 = mode##_resolve(c, operand);               \
+        byte cycle2 = fn(c);                                    \
+        c->cycles += (cycle1 & cycle2);                         \
+        c->P |= FLAG_U;                                         \
+        byte cycles = c->cycles;                                \
+        c->cycles = 0;                                          \
+        return cycles;                                          \
+    }
+#include "./opcodes.def"
+#undef OPCODE
+
+#endif // !CPU_EXEC_H_
@@ -2,23 +2,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-#include "./cpu.h"
-
-void throw_exception(const int error) {
-    switch(error) {
-    case ACCESS_VIOLATION:
-        perror("access violation!\n");
-        break;
-    case SEGFAULT:
-        perror("segmentation fault!\n");
-        break;
-    }
-#ifdef _DEBUG
-    EXCEPTION
-#else
-    exit(error);
-#endif // _DEBUG
-}
+#include "./board.h"
 
 // Function to print the binary representation of a byte
 void print_binary(unsigned char value) {
@@ -35,8 +19,8 @@ void debug_print_CPU(struct cpu *c) {
     printf("Index Register Y: %02X\n", c->Y);
     printf("Stack Pointer (SP): %02X\n", c->SP);
     
-    printf("Processor Status Register (P): %02X (Binary: ", c->P);
-    print_binary(c->P);
+    printf("Processor Status Register (P): %02X (Binary: ", cpu_get_P(c));
+    print_binary(cpu_get_P(c));
     printf(")\n");
     
     printf("  Carry (C): %d\n", cpu_get_flag(c, FLAG_C));
@@ -57,3 +41,13 @@ void debug_print_CPU(struct cpu *c) {
     printf("Address Relative: %04X\n", c->address_relative);
     printf("Data Bus: %02X\n", c->data_bus);
 }
+
+// Debug print function for the clock, reports the frequency actually achieved
+void debug_print_clock(struct Clock *clk) {
+    if (clk->turbo) {
+        printf("Clock: %.3f MHz (turbo)\n", clk->mhz);
+    } else {
+        printf("Clock: %.3f MHz (target %.3f MHz, x%.2f)\n",
+               clk->mhz, clk->frequency * clk->speed / 1e6, clk->speed);
+    }
+}
@@ -2,16 +2,17 @@
 #ifndef DEBUG_TOOLS_H
 #define DEBUG_TOOLS_H
 
-#define EXCEPTION __builtin_trap()
-
+// Fault codes, see board_fault(), the emulator exits with them
 #define ACCESS_VIOLATION 0xFF
 #define SEGFAULT 0xFE
+#define ILLEGAL_OPCODE 0xFD
 
 
 typedef struct cpu cpu;
+typedef struct Clock Clock;
 
-void throw_exception(const int error);
 void print_binary(unsigned char value);
 void debug_print_CPU(struct cpu *c);
+void debug_print_clock(struct Clock *clk);
 
 #endif // DEBUG_TOOLS_H
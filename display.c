@@ -0,0 +1,175 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "./board.h"
+#include "./display.h"
+
+// ANSI: cursor to the top left, erase from the cursor to the end of screen
+#define DISPLAY_HOME "\x1b[H"
+#define DISPLAY_ERASE "\x1b[J"
+
+static void display_wake(Display *d) {
+    pthread_mutex_lock(&d->lock);
+    pthread_cond_broadcast(&d->wake);
+    pthread_mutex_unlock(&d->lock);
+}
+
+// Renderer: sleeps until something newer than `seq` is published or the
+// display stops
+static void display_wait(Display *d, unsigned seq) {
+    pthread_mutex_lock(&d->lock);
+    atomic_store(&d->waiting, true);
+    while (atomic_load(&d->seq) == seq && atomic_load(&d->running)) {
+        pthread_cond_wait(&d->wake, &d->lock);
+    }
+    atomic_store(&d->waiting, false);
+    pthread_mutex_unlock(&d->lock);
+}
+
+void display_publish(Display *d, const Board *b) {
+    unsigned seq = atomic_load_explicit(&d->seq, memory_order_relaxed);
+    atomic_store_explicit(&d->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    Snapshot *s = &d->snap;
+    s->c = *b->c;
+    s->clk = b->clk;
+    s->icache = b->icache != NULL;
+    if (s->icache) {
+        s->icache_hits = b->icache->hits;
+        s->icache_misses = b->icache->misses;
+    }
+    s->blocks = b->blocks != NULL;
+    if (s->blocks) {
+        s->blocks_run = b->blocks->blocks;
+        s->blocks_translated = b->blocks->misses;
+        s->block_ops = b->blocks->ops;
+        s->block_fused = b->blocks->fused;
+    }
+    s->dynarec = b->dynarec != NULL;
+    if (s->dynarec) {
+        s->jit_translated = b->dynarec->translated;
+        s->jit_flushes = b->dynarec->flushes;
+        s->jit_mismatches = b->dynarec->mismatches;
+        s->jit_used = b->dynarec->used;
+        s->jit_verify = b->dynarec->verify;
+    }
+    s->aot = b->aot != NULL;
+    if (s->aot) {
+        s->aot_steps = b->aot->steps;
+        s->aot_fallbacks = b->aot->fallbacks;
+    }
+    s->idle_loops = b->idle.loops;
+    s->idle_skipped = b->idle.skipped;
+
+    // sequentially consistent with the renderer's check in display_wait()
+    atomic_store(&d->seq, seq + 2);
+    if (atomic_load(&d->waiting)) {
+        display_wake(d);
+    }
+}
+
+unsigned display_read(Display *d, Snapshot *s) {
+    unsigned before, after;
+    do {
+        before = atomic_load_explicit(&d->seq, memory_order_acquire);
+        memcpy(s, &d->snap, sizeof(*s));
+        atomic_thread_fence(memory_order_acquire);
+        after = atomic_load_explicit(&d->seq, memory_order_relaxed);
+    } while ((before & 1) || before != after);
+    return before;
+}
+
+// One frame, written out in a single flush
+static void display_render(Snapshot *s) {
+    printf(DISPLAY_HOME);
+    debug_print_CPU(&s->c);
+    debug_print_clock(&s->clk);
+    if (s->icache) {
+        uint64_t lookups = s->icache_hits + s->icache_misses;
+        printf("ICache: %llu hits, %llu misses (%.2f%% hit rate)\n",
+               (unsigned long long)s->icache_hits, (unsigned long long)s->icache_misses,
+               lookups ? 100.0 * s->icache_hits / lookups : 0.0);
+    }
+    if (s->blocks) {
+        printf("Blocks: %llu run, %llu translated (%.2f instructions/block), %llu superinstructions\n",
+               (unsigned long long)s->blocks_run, (unsigned long long)s->blocks_translated,
+               s->blocks_run ? (double)s->block_ops / s->blocks_run : 0.0,
+               (unsigned long long)s->block_fused);
+    }
+    if (s->dynarec) {
+        printf("Dynarec: %llu blocks translated, %zu bytes used, %llu flushes",
+               (unsigned long long)s->jit_translated, s->jit_used, (unsigned long long)s->jit_flushes);
+        if (s->jit_verify) {
+            printf(", %llu mismatches", (unsigned long long)s->jit_mismatches);
+        }
+        printf("\n");
+    }
+    if (s->aot) {
+        printf("AOT: %llu recompiled steps, %llu instructions interpreted\n",
+               (unsigned long long)s->aot_steps, (unsigned long long)s->aot_fallbacks);
+    }
+    printf("Idle: %llu cycles skipped in %llu fast-forwards\n",
+           (unsigned long long)s->idle_skipped, (unsigned long long)s->idle_loops);
+    if (s->c.halted) {
+        printf("CPU jammed at $%04X (opcode $%02X), waiting for reset (kill -USR1 %d)\n",
+               s->c.PC, s->c.IR, (int)getpid());
+    }
+    printf(DISPLAY_ERASE);
+    fflush(stdout);
+}
+
+static void *display_thread(void *arg) {
+    Display *d = arg;
+    Snapshot s;
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    unsigned drawn = 1;     // odd, never a published sequence
+
+    while (atomic_load(&d->running)) {
+        unsigned seq = display_read(d, &s);
+        if (seq != drawn) {
+            display_render(&s);
+            drawn = seq;
+        }
+        if (s.c.halted) {
+            // the emulation thread sleeps until a reset, so does the screen
+            display_wait(d, seq);
+            clock_gettime(CLOCK_MONOTONIC, &next);
+            continue;
+        }
+
+        // absolute deadlines, a slow frame does not push the next ones back
+        next.tv_nsec += 1000000000L / DISPLAY_HZ;
+        if (next.tv_nsec >= 1000000000L) {
+            next.tv_nsec -= 1000000000L;
+            next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    }
+    return NULL;
+}
+
+bool display_start(Display *d, const Board *b) {
+    atomic_init(&d->seq, 0);
+    atomic_init(&d->waiting, false);
+    pthread_mutex_init(&d->lock, NULL);
+    pthread_cond_init(&d->wake, NULL);
+    display_publish(d, b);
+    atomic_init(&d->running, true);
+
+    // whole frames per write, cleared once
+    setvbuf(stdout, NULL, _IOFBF, 1 << 16);
+    printf("\x1b[2J");
+    return pthread_create(&d->thread, NULL, display_thread, d) == 0;
+}
+
+void display_stop(Display *d) {
+    atomic_store(&d->running, false);
+    display_wake(d);
+    pthread_join(d->thread, NULL);
+    pthread_cond_destroy(&d->wake);
+    pthread_mutex_destroy(&d->lock);
+}
@@ -0,0 +1,62 @@
+#ifndef DISPLAY_H_
+#define DISPLAY_H_
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+
+#include "./arch.h"
+#include "./cpu.h"
+#include "./clock.h"
+
+// Status screen refreshes per second
+#define DISPLAY_HZ 30
+
+typedef struct Board Board;
+
+// Everything the status screen shows, copied out of the board between two
+// runs so it is consistent
+typedef struct Snapshot {
+    cpu c;
+    Clock clk;
+
+    // engines in use, their counters below are only valid if set
+    bool icache, blocks, dynarec, aot;
+    uint64_t icache_hits, icache_misses;
+    uint64_t blocks_run, blocks_translated, block_ops, block_fused;
+    uint64_t jit_translated, jit_flushes, jit_mismatches;
+    size_t jit_used;
+    bool jit_verify;
+    uint64_t aot_steps, aot_fallbacks;
+    uint64_t idle_loops, idle_skipped;
+} Snapshot;
+
+// Seqlock between the emulation thread, the only writer, and the renderer
+// thread: seq is odd while snap is being written, readers retry until they
+// copied it whole between two equal even values
+typedef struct Display {
+    atomic_uint seq;
+    Snapshot snap;
+
+    pthread_t thread;
+    atomic_bool running;
+
+    // The renderer sleeps here while the CPU is halted and nothing new has
+    // been published, `waiting` tells display_publish() to wake it
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    atomic_bool waiting;
+} Display;
+
+// Publishes b, then starts the renderer thread drawing at DISPLAY_HZ with
+// ANSI cursor moves
+bool display_start(Display *d, const Board *b);
+// Stops the renderer thread after its current frame
+void display_stop(Display *d);
+
+// Emulation thread: publishes the board state, never waits for the renderer
+void display_publish(Display *d, const Board *b);
+// Latest published state, returns its sequence number
+unsigned display_read(Display *d, Snapshot *s);
+
+#endif // !DISPLAY_H_
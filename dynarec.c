@@ -0,0 +1,466 @@
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "./board.h"
+
+// Worst case code size of one translated block (inline CMP # is the
+// longest instruction, a call is 61 bytes)
+#define DYNAREC_PROLOGUE 21
+#define DYNAREC_PER_OP 64
+#define DYNAREC_EPILOGUE 18
+#define DYNAREC_MAX_BLOCK \
+    (DYNAREC_PROLOGUE + BLOCK_MAX_OPS * DYNAREC_PER_OP + DYNAREC_EPILOGUE)
+
+#if defined(__x86_64__)
+
+Dynarec *dynarec_init(void) {
+    Dynarec *jit = (Dynarec *)calloc(1, sizeof(Dynarec));
+    if (jit == NULL) {
+        return NULL;
+    }
+    // never writable and executable at once, see dynarec_protect()
+    jit->arena = mmap(NULL, DYNAREC_ARENA_SIZE, PROT_READ | PROT_EXEC,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (jit->arena == MAP_FAILED) {
+        perror("failed to map the dynarec arena");
+        free(jit);
+        return NULL;
+    }
+    return jit;
+}
+
+#else
+
+Dynarec *dynarec_init(void) {
+    // no backend for this host
+    return NULL;
+}
+
+#endif // __x86_64__
+
+void dynarec_shutdown(Dynarec *jit) {
+    if (jit == NULL) {
+        return;
+    }
+    munmap(jit->arena, DYNAREC_ARENA_SIZE);
+    free(jit->ram_before);
+    free(jit->ram_after);
+    free(jit);
+}
+
+void dynarec_reset(Dynarec *jit) {
+    jit->used = 0;
+    jit->verify = false;
+    jit->translated = 0;
+    jit->flushes = 0;
+    jit->mismatches = 0;
+}
+
+bool dynarec_set_verify(Dynarec *jit, bool verify) {
+    if (verify && jit->ram_before == NULL) {
+        jit->ram_before = (byte *)malloc(RAM_SIZE);
+        jit->ram_after = (byte *)malloc(RAM_SIZE);
+        if (jit->ram_before == NULL || jit->ram_after == NULL) {
+            return false;
+        }
+    }
+    jit->verify = verify;
+    return true;
+}
+
+#if defined(__x86_64__)
+
+// x86-64 emitters, all little endian
+static byte *emit8(byte *p, byte v) {
+    *p++ = v;
+    return p;
+}
+
+static byte *emit32(byte *p, uint32_t v) {
+    memcpy(p, &v, sizeof(v));
+    return p + sizeof(v);
+}
+
+static byte *emit64(byte *p, uint64_t v) {
+    memcpy(p, &v, sizeof(v));
+    return p + sizeof(v);
+}
+
+static byte *emit(byte *p, const byte *bytes, size_t n) {
+    memcpy(p, bytes, n);
+    return p + n;
+}
+
+// Switches the arena pages holding [start, start + size) between writable
+// and executable, around the emission of one block
+static bool dynarec_protect(byte *start, size_t size, int prot) {
+    uintptr_t page = sysconf(_SC_PAGESIZE);
+    uintptr_t first = (uintptr_t)start & ~(page - 1);
+    uintptr_t end = ((uintptr_t)start + size + page - 1) & ~(page - 1);
+    return mprotect((void *)first, end - first, prot) == 0;
+}
+
+// Drops every translation, the arena is reused from the start
+static void dynarec_flush(Dynarec *jit, BlockCache *bc) {
+    for (unsigned i = 0; i < BLOCK_LINES; i++) {
+        bc->lines[i].native = NULL;
+        bc->lines[i].runs = 0;
+    }
+    jit->used = 0;
+    jit->flushes++;
+}
+
+// [rbx + field] operands, rbx holds the cpu *
+#define CPU_FIELD(field) ((byte)offsetof(cpu, field))
+
+// P = (P & keep) | set, with U set like every other instruction
+static byte *emit_flags(byte *p, byte keep, byte set) {
+    p = emit(p, (const byte[]){0x80, 0x63, CPU_FIELD(P), keep}, 4);        // and byte [P], keep
+    return emit(p, (const byte[]){0x80, 0x4B, CPU_FIELD(P), set | FLAG_U}, 4); // or byte [P], set
+}
+
+#ifdef CPU_LAZY_FLAGS
+
+// N and Z from al
+static byte *emit_nz(byte *p) {
+    p = emit(p, (const byte[]){0x88, 0x43, CPU_FIELD(nr)}, 3);            // mov [nr], al
+    p = emit(p, (const byte[]){0x88, 0x43, CPU_FIELD(zr)}, 3);            // mov [zr], al
+    return emit_flags(p, 0xFF, 0);
+}
+
+// N and Z from a constant
+static byte *emit_nz_imm(byte *p, byte value) {
+    p = emit(p, (const byte[]){0xC6, 0x43, CPU_FIELD(nr), value}, 4);     // mov byte [nr], value
+    p = emit(p, (const byte[]){0xC6, 0x43, CPU_FIELD(zr), value}, 4);     // mov byte [zr], value
+    return emit_flags(p, 0xFF, 0);
+}
+
+static byte *emit_c(byte *p, bool set) {
+    p = emit(p, (const byte[]){0xC6, 0x43, CPU_FIELD(carry), set}, 4);    // mov byte [carry], set
+    return emit_flags(p, 0xFF, 0);
+}
+
+static byte *emit_clv(byte *p) {
+    p = emit(p, (const byte[]){0xC6, 0x43, CPU_FIELD(ovf), 0}, 4);        // mov byte [ovf], 0
+    return emit_flags(p, 0xFF, 0);
+}
+
+// al = reg - imm, with C, N and Z as CMP leaves them
+static byte *emit_compare(byte *p, byte reg, byte imm) {
+    p = emit(p, (const byte[]){0x8A, 0x43, reg}, 3);                      // mov al, [reg]
+    p = emit(p, (const byte[]){0x2C, imm}, 2);                            // sub al, imm
+    p = emit(p, (const byte[]){0x0F, 0x93, 0x43, CPU_FIELD(carry)}, 4);   // setae byte [carry]
+    return emit_nz(p);
+}
+
+#else
+
+// dl holds P with N and Z cleared: sets them from al and stores P back
+static byte *emit_nz_from_al(byte *p) {
+    static const byte nz[] = {
+        0x84, 0xC0,             // test al, al
+        0x0F, 0x94, 0xC1,       // sete cl
+        0x00, 0xC9,             // add cl, cl (FLAG_Z)
+        0x08, 0xCA,             // or dl, cl
+        0x88, 0xC1,             // mov cl, al
+        0x80, 0xE1, FLAG_N,     // and cl, FLAG_N
+        0x08, 0xCA,             // or dl, cl
+        0x80, 0xCA, FLAG_U,     // or dl, FLAG_U
+    };
+    p = emit(p, nz, sizeof(nz));
+    return emit(p, (const byte[]){0x88, 0x53, CPU_FIELD(P)}, 3);          // mov [P], dl
+}
+
+// dl = P & keep
+static byte *emit_load_flags(byte *p, byte keep) {
+    p = emit(p, (const byte[]){0x0F, 0xB6, 0x53, CPU_FIELD(P)}, 4);       // movzx edx, byte [P]
+    return emit(p, (const byte[]){0x83, 0xE2, keep}, 3);                  // and edx, keep
+}
+
+// N and Z from al
+static byte *emit_nz(byte *p) {
+    p = emit_load_flags(p, (byte)~(FLAG_N | FLAG_Z));
+    return emit_nz_from_al(p);
+}
+
+// N and Z from a constant
+static byte *emit_nz_imm(byte *p, byte value) {
+    return emit_flags(p, (byte)~(FLAG_N | FLAG_Z), (value == 0 ? FLAG_Z : 0) | (value & FLAG_N));
+}
+
+static byte *emit_c(byte *p, bool set) {
+    return emit_flags(p, (byte)~FLAG_C, set ? FLAG_C : 0);
+}
+
+static byte *emit_clv(byte *p) {
+    return emit_flags(p, (byte)~FLAG_V, 0);
+}
+
+// al = reg - imm, with C, N and Z as CMP leaves them
+static byte *emit_compare(byte *p, byte reg, byte imm) {
+    p = emit_load_flags(p, (byte)~(FLAG_N | FLAG_Z | FLAG_C));
+    p = emit(p, (const byte[]){0x8A, 0x43, reg}, 3);                      // mov al, [reg]
+    p = emit(p, (const byte[]){0x2C, imm}, 2);                            // sub al, imm
+    p = emit(p, (const byte[]){0x0F, 0x93, 0xC1}, 3);                     // setae cl (FLAG_C)
+    p = emit(p, (const byte[]){0x08, 0xCA}, 2);                           // or dl, cl
+    return emit_nz_from_al(p);
+}
+
+#endif // CPU_LAZY_FLAGS
+
+// The latches an immediate operand leaves behind, later ACC mode
+// instructions read them (see cpu_decode())
+static byte *emit_imm_latches(byte *p, word address, byte data) {
+    p = emit(p, (const byte[]){0x66, 0xC7, 0x43, CPU_FIELD(address_bus)}, 4);
+    p = emit(p, (const byte[]){address & 0xFF, address >> 8}, 2);         // mov word [address_bus], address
+    return emit(p, (const byte[]){0xC6, 0x43, CPU_FIELD(data_bus), data}, 4); // mov byte [data_bus], data
+}
+
+// Emits the handful of implied and immediate instructions that are simple
+// enough to generate inline, bit for bit what their handlers do. Returns
+// NULL for everything else, which is called through cpu_exec_table.
+static byte *emit_inline(byte *p, Board *b, const BlockOp *op) {
+    byte imm = 0;
+    if (cpu_code_table[op->IR].addressing_mode == &IMM) {
+        // code pages are watched, the value cannot change behind our back
+        imm = board_read(b, op->operand);
+    }
+
+    switch (op->IR) {
+    case 0x18: p = emit_c(p, false); break;                     // CLC
+    case 0x38: p = emit_c(p, true); break;                      // SEC
+    case 0x58: p = emit_flags(p, (byte)~FLAG_I, 0); break;      // CLI
+    case 0x78: p = emit_flags(p, 0xFF, FLAG_I); break;          // SEI
+    case 0xB8: p = emit_clv(p); break;                          // CLV
+    case 0xD8: p = emit_flags(p, (byte)~FLAG_D, 0); break;      // CLD
+    case 0xF8: p = emit_flags(p, 0xFF, FLAG_D); break;          // SED
+    case 0xEA: p = emit_flags(p, 0xFF, 0); break;               // NOP
+
+    case 0xE8:                                                  // INX
+    case 0xCA:                                                  // DEX
+    case 0x88: {                                                // DEY
+        // (INY sets its flags from X, it stays a call)
+        byte reg = op->IR == 0x88 ? CPU_FIELD(Y) : CPU_FIELD(X);
+        p = emit(p, (const byte[]){0x8A, 0x43, reg}, 3);                  // mov al, [reg]
+        p = emit(p, (const byte[]){0xFE, op->IR == 0xE8 ? 0xC0 : 0xC8}, 2); // inc/dec al
+        p = emit(p, (const byte[]){0x88, 0x43, reg}, 3);                  // mov [reg], al
+        p = emit_nz(p);
+        break;
+    }
+
+    case 0xAA:                                                  // TAX
+    case 0xA8:                                                  // TAY
+    case 0x8A:                                                  // TXA
+    case 0x98: {                                                // TYA
+        byte from = op->IR == 0x8A ? CPU_FIELD(X) : op->IR == 0x98 ? CPU_FIELD(Y) : CPU_FIELD(A);
+        byte to = op->IR == 0xAA ? CPU_FIELD(X) : op->IR == 0xA8 ? CPU_FIELD(Y) : CPU_FIELD(A);
+        p = emit(p, (const byte[]){0x8A, 0x43, from}, 3);                 // mov al, [from]
+        p = emit(p, (const byte[]){0x88, 0x43, to}, 3);                   // mov [to], al
+        p = emit_nz(p);
+        break;
+    }
+
+    case 0xA9:                                                  // LDA #
+    case 0xA2:                                                  // LDX #
+    case 0xA0: {                                                // LDY #
+        byte to = op->IR == 0xA2 ? CPU_FIELD(X) : op->IR == 0xA0 ? CPU_FIELD(Y) : CPU_FIELD(A);
+        p = emit_imm_latches(p, op->operand, imm);
+        p = emit(p, (const byte[]){0xC6, 0x43, to, imm}, 4);              // mov byte [to], imm
+        p = emit_nz_imm(p, imm);
+        break;
+    }
+
+    case 0x29:                                                  // AND #
+    case 0x09:                                                  // ORA #
+    case 0x49: {                                                // EOR #
+        byte alu = op->IR == 0x29 ? 0x24 : op->IR == 0x09 ? 0x0C : 0x34;
+        p = emit_imm_latches(p, op->operand, imm);
+        p = emit(p, (const byte[]){0x8A, 0x43, CPU_FIELD(A)}, 3);         // mov al, [A]
+        p = emit(p, (const byte[]){alu, imm}, 2);                         // and/or/xor al, imm
+        p = emit(p, (const byte[]){0x88, 0x43, CPU_FIELD(A)}, 3);         // mov [A], al
+        p = emit_nz(p);
+        break;
+    }
+
+    case 0xC9:                                                  // CMP #
+    case 0xE0:                                                  // CPX #
+    case 0xC0: {                                                // CPY #
+        byte reg = op->IR == 0xE0 ? CPU_FIELD(X) : op->IR == 0xC0 ? CPU_FIELD(Y) : CPU_FIELD(A);
+        p = emit_imm_latches(p, op->operand, imm);
+        p = emit_compare(p, reg, imm);
+        break;
+    }
+
+    default:
+        return NULL;
+    }
+
+    // constant cost, none of these can cross a page
+    return emit(p, (const byte[]){0x41, 0x83, 0xC4, cpu_code_table[op->IR].cycles}, 4); // add r12d, cycles
+}
+
+// add word [PC], n
+static byte *emit_advance_pc(byte *p, byte n) {
+    return emit(p, (const byte[]){0x66, 0x83, 0x43, CPU_FIELD(PC), n}, 5);
+}
+
+#endif // __x86_64__
+
+// Simple instructions are generated inline, the rest become calls into
+// cpu_exec_table. PC and IR are only stored ahead of a call and on the way
+// out, the cycles are summed in a register:
+//
+//     push rbx; push r12; push r13     ; keeps rsp 16 byte aligned for calls
+//     mov rbx, rdi                     ; cpu *
+//     xor r12d, r12d                   ; cycles
+//     mov r13, &blk->valid
+//   inline instruction:
+//     ...                              ; see emit_inline()
+//     add r12d, cycles
+//   called instruction:
+//     add word [rbx + PC], pending     ; lengths since the last store
+//     mov byte [rbx + IR], op->IR
+//     mov rdi, rbx
+//     mov esi, op->operand
+//     mov rax, op->run
+//     call rax
+//     add r12d, eax
+//     cmp byte [r13], 0                ; not after the last one
+//     je exit                          ; a store invalidated the block
+//     mov al, [&b->stop]
+//     test al, al
+//     jne exit                         ; a fault or write breakpoint
+//   exit:
+//     add word [rbx + PC], pending     ; if the block ends inline
+//     mov byte [rbx + IR], last IR
+//     mov eax, r12d
+//     pop r13; pop r12; pop rbx
+//     ret
+bool dynarec_translate(Dynarec *jit, Board *b, Block *blk) {
+#if defined(__x86_64__)
+    if (jit->used + DYNAREC_MAX_BLOCK > DYNAREC_ARENA_SIZE) {
+        dynarec_flush(jit, b->blocks);
+    }
+
+    byte *start = jit->arena + jit->used;
+    if (!dynarec_protect(start, DYNAREC_MAX_BLOCK, PROT_READ | PROT_WRITE)) {
+        return false;
+    }
+    byte *p = start;
+    byte *exits[2 * BLOCK_MAX_OPS];
+    int exit_count = 0;
+    byte pending = 0;
+
+    static const byte prologue[] = {
+        0x53,                   // push rbx
+        0x41, 0x54,             // push r12
+        0x41, 0x55,             // push r13
+        0x48, 0x89, 0xFB,       // mov rbx, rdi
+        0x45, 0x31, 0xE4,       // xor r12d, r12d
+        0x49, 0xBD,             // mov r13, imm64
+    };
+    p = emit(p, prologue, sizeof(prologue));
+    p = emit64(p, (uint64_t)(uintptr_t)&blk->valid);
+
+    for (int i = 0; i < blk->count; i++) {
+        const BlockOp *op = &blk->ops[i];
+        pending += op->length;
+
+        byte *inlined = emit_inline(p, b, op);
+        if (inlined != NULL) {
+            p = inlined;
+            continue;
+        }
+
+        p = emit_advance_pc(p, pending);
+        pending = 0;
+        p = emit(p, (const byte[]){0xC6, 0x43, CPU_FIELD(IR), op->IR}, 4); // mov byte [IR], IR
+        p = emit(p, (const byte[]){0x48, 0x89, 0xDF}, 3);      // mov rdi, rbx
+        p = emit8(p, 0xBE);                                     // mov esi, imm32
+        p = emit32(p, op->operand);
+        p = emit(p, (const byte[]){0x48, 0xB8}, 2);            // mov rax, imm64
+        p = emit64(p, (uint64_t)(uintptr_t)op->run);
+        p = emit(p, (const byte[]){0xFF, 0xD0}, 2);            // call rax
+        p = emit(p, (const byte[]){0x41, 0x01, 0xC4}, 3);      // add r12d, eax
+        if (i + 1 < blk->count) {
+            p = emit(p, (const byte[]){0x41, 0x80, 0x7D, 0x00, 0x00}, 5); // cmp byte [r13], 0
+            p = emit(p, (const byte[]){0x0F, 0x84}, 2);        // je rel32
+            exits[exit_count++] = p;
+            p = emit32(p, 0);
+            p = emit8(p, 0xA0);                                 // mov al, [moffs64]
+            p = emit64(p, (uint64_t)(uintptr_t)&b->stop);
+            p = emit(p, (const byte[]){0x84, 0xC0, 0x0F, 0x85}, 4); // test al, al; jne rel32
+            exits[exit_count++] = p;
+            p = emit32(p, 0);
+        }
+    }
+    if (pending != 0) {
+        p = emit_advance_pc(p, pending);
+        p = emit(p, (const byte[]){0xC6, 0x43, CPU_FIELD(IR), blk->ops[blk->count - 1].IR}, 4);
+    }
+
+    byte *exit = p;
+    static const byte epilogue[] = {
+        0x44, 0x89, 0xE0,       // mov eax, r12d
+        0x41, 0x5D,             // pop r13
+        0x41, 0x5C,             // pop r12
+        0x5B,                   // pop rbx
+        0xC3,                   // ret
+    };
+    p = emit(p, epilogue, sizeof(epilogue));
+    for (int i = 0; i < exit_count; i++) {
+        emit32(exits[i], (uint32_t)(exit - (exits[i] + 4)));
+    }
+
+    if (!dynarec_protect(start, DYNAREC_MAX_BLOCK, PROT_READ | PROT_EXEC)) {
+        return false;
+    }
+    jit->used += p - start;
+    jit->translated++;
+    blk->native = (native_t)(uintptr_t)start;
+    return true;
+#else
+    UNUSED(jit);
+    UNUSED(b);
+    UNUSED(blk);
+    return false;
+#endif // __x86_64__
+}
+
+byte dynarec_verify(cpu *c, Block *blk) {
+    Board *b = c->bc;
+    Dynarec *jit = b->dynarec;
+    cpu before = *c;
+    memcpy(jit->ram_before, b->ram, RAM_SIZE);
+
+    byte cycles = blk->native(c);
+    byte ops = block_executed(blk, c->PC, b->stop);
+    cpu after = *c;
+    memcpy(jit->ram_after, b->ram, RAM_SIZE);
+
+    // replay the same instructions on the reference interpreter
+    *c = before;
+    memcpy(b->ram, jit->ram_before, RAM_SIZE);
+    byte expected = 0;
+    for (byte i = 0; i < ops; i++) {
+        expected += cpu_step_table(c);
+    }
+
+    if (cycles != expected || c->A != after.A || c->X != after.X || c->Y != after.Y
+        || c->SP != after.SP || cpu_get_P(c) != cpu_get_P(&after) || c->PC != after.PC
+        || memcmp(b->ram, jit->ram_after, RAM_SIZE) != 0) {
+        jit->mismatches++;
+        fprintf(stderr, "dynarec: block $%04X (%d instructions) differs from the interpreter\n",
+                blk->pc, ops);
+        fprintf(stderr, "  native:      PC=%04X A=%02X X=%02X Y=%02X SP=%02X P=%02X cycles=%d\n",
+                after.PC, after.A, after.X, after.Y, after.SP, cpu_get_P(&after), cycles);
+        fprintf(stderr, "  interpreter: PC=%04X A=%02X X=%02X Y=%02X SP=%02X P=%02X cycles=%d\n",
+                c->PC, c->A, c->X, c->Y, c->SP, cpu_get_P(c), expected);
+    }
+    return expected;
+}
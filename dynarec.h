@@ -0,0 +1,48 @@
+#ifndef DYNAREC_H_
+#define DYNAREC_H_
+
+#include <stddef.h>
+
+#include "./arch.h"
+#include "./block.h"
+
+typedef struct Board Board;
+
+// Runs after which a block is translated to native code
+#define DYNAREC_HOT 64
+
+// Executable arena, flushed whole when full
+#define DYNAREC_ARENA_SIZE (1 << 20)
+
+typedef struct Dynarec {
+    byte *arena;
+    size_t used;
+    bool verify;            // replay every native block on the interpreter
+
+    uint64_t translated;    // blocks translated
+    uint64_t flushes;       // arena flushes
+    uint64_t mismatches;    // verify mode differences
+
+    // verify mode snapshots of b->ram, before and after the native run
+    byte *ram_before;
+    byte *ram_after;
+} Dynarec;
+
+// NULL if the host has no backend (x86-64 only) or no executable memory
+Dynarec *dynarec_init(void);
+void dynarec_shutdown(Dynarec *jit);
+// Rewinds the arena, keeping its mapping, and clears verify mode and the
+// counters. The blocks' native code must be dropped too, see block_reset().
+void dynarec_reset(Dynarec *jit);
+
+bool dynarec_set_verify(Dynarec *jit, bool verify);
+
+// Translates blk into the arena and sets blk->native, false if it could not
+bool dynarec_translate(Dynarec *jit, Board *b, Block *blk);
+
+// Runs blk->native, then restores the state it started from, runs the same
+// instructions on the reference interpreter and reports any difference. The
+// interpreter's result is kept. Device accesses happen twice.
+byte dynarec_verify(cpu *c, Block *blk);
+
+#endif // !DYNAREC_H_
@@ -0,0 +1,280 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "./board.h"
+#include "./debug_tools.h"
+#include "./pool.h"
+
+// Board farm: runs many independent boards on a pool of worker threads, in
+// quanta of a few cycles each. A worker runs the board at the front of its
+// deque for one quantum and puts it back at the end, so every board it
+// holds gets its turn however long the others run. A worker with an empty
+// deque steals from the end of another one.
+
+// Cycles per board by default
+#define FARM_CYCLES 100000000ULL
+// Cycles a board runs before the next one gets the worker
+#define FARM_QUANTUM 1000000ULL
+// Nap of a worker with nothing to run or steal, in ns
+#define FARM_NAP 10000
+
+typedef struct Job {
+    Board *b;
+    const char *rom;
+    uint64_t ran;
+} Job;
+
+// Ring of jobs, the owner takes from the front and thieves from the back
+typedef struct Deque {
+    pthread_mutex_t lock;
+    Job **jobs;
+    unsigned head;
+    unsigned count;
+    unsigned capacity;
+} Deque;
+
+typedef struct Farm Farm;
+
+// Cache line aligned, workers only touch their own but for steals
+typedef struct Worker {
+    _Alignas(64) Deque deque;
+    Farm *farm;
+    pthread_t thread;
+    unsigned seed;
+    uint64_t quanta;
+    uint64_t steals;
+} Worker;
+
+struct Farm {
+    Worker *workers;
+    int worker_count;
+    uint64_t cycles;
+    uint64_t quantum;
+    atomic_int remaining;   // jobs not finished yet
+};
+
+static double seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static void deque_push(Deque *d, Job *job) {
+    pthread_mutex_lock(&d->lock);
+    d->jobs[(d->head + d->count++) % d->capacity] = job;
+    pthread_mutex_unlock(&d->lock);
+}
+
+static Job *deque_pop_front(Deque *d) {
+    Job *job = NULL;
+    pthread_mutex_lock(&d->lock);
+    if (d->count != 0) {
+        job = d->jobs[d->head];
+        d->head = (d->head + 1) % d->capacity;
+        d->count--;
+    }
+    pthread_mutex_unlock(&d->lock);
+    return job;
+}
+
+static Job *deque_pop_back(Deque *d) {
+    Job *job = NULL;
+    pthread_mutex_lock(&d->lock);
+    if (d->count != 0) {
+        job = d->jobs[(d->head + --d->count) % d->capacity];
+    }
+    pthread_mutex_unlock(&d->lock);
+    return job;
+}
+
+// Another worker's job, victims picked from a random one on
+static Job *farm_steal(Worker *w) {
+    Farm *f = w->farm;
+    int first = rand_r(&w->seed) % f->worker_count;
+    for (int i = 0; i < f->worker_count; i++) {
+        Worker *victim = &f->workers[(first + i) % f->worker_count];
+        if (victim == w) {
+            continue;
+        }
+        Job *job = deque_pop_back(&victim->deque);
+        if (job != NULL) {
+            w->steals++;
+            return job;
+        }
+    }
+    return NULL;
+}
+
+// Done when the budget has run or the CPU halted
+static bool farm_finished(const Farm *f, const Job *job) {
+    return job->ran >= f->cycles || job->b->c->halted;
+}
+
+static void *farm_worker(void *arg) {
+    Worker *w = arg;
+    Farm *f = w->farm;
+    while (atomic_load(&f->remaining) > 0) {
+        Job *job = deque_pop_front(&w->deque);
+        if (job == NULL) {
+            job = farm_steal(w);
+        }
+        if (job == NULL) {
+            // the last boards are running elsewhere
+            nanosleep(&(struct timespec){0, FARM_NAP}, NULL);
+            continue;
+        }
+        uint64_t left = f->cycles - job->ran;
+        job->ran += board_run_cycles(job->b, left < f->quantum ? left : f->quantum);
+        w->quanta++;
+        if (farm_finished(f, job)) {
+            atomic_fetch_sub(&f->remaining, 1);
+        } else {
+            deque_push(&w->deque, job);
+        }
+    }
+    return NULL;
+}
+
+static const char *farm_status(const Board *b) {
+    if (b->fault == ACCESS_VIOLATION) {
+        return "access-violation";
+    }
+    if (b->fault == ILLEGAL_OPCODE) {
+        return "illegal-opcode";
+    }
+    return b->c->halted ? "jam" : "done";
+}
+
+static const char *engine_names[] = {"interp", "icache", "block", "dynarec", "aot", "batch"};
+
+static int farm_engine(const char *name) {
+    for (unsigned i = 0; i < sizeof(engine_names) / sizeof(engine_names[0]); i++) {
+        if (strcmp(name, engine_names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int main(int argc, char **argv) {
+    int threads = sysconf(_SC_NPROCESSORS_ONLN);
+    int copies = 1;
+    int engine = ENGINE_INTERP;
+    bool verbose = false;
+    bool huge = false;
+    Farm f = {.cycles = FARM_CYCLES, .quantum = FARM_QUANTUM};
+    // ROM paths, gathered at the front of argv
+    char **roms = argv + 1;
+    int rom_count = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            copies = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+            f.cycles = strtoull(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "-q") == 0 && i + 1 < argc) {
+            f.quantum = strtoull(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--engine") == 0 && i + 1 < argc) {
+            engine = farm_engine(argv[++i]);
+        } else if (strcmp(argv[i], "-v") == 0) {
+            verbose = true;
+        } else if (strcmp(argv[i], "--huge") == 0) {
+            huge = true;
+        } else {
+            roms[rom_count++] = argv[i];
+        }
+    }
+    if (rom_count == 0 || threads < 1 || copies < 1 || f.quantum == 0 || engine < 0) {
+        fprintf(stderr, "usage: %s ROM... [-j THREADS] [-n COPIES] [-c CYCLES] [-q QUANTUM] "
+                "[--engine interp|icache|block|dynarec|aot|batch] [--huge] [-v]\n", argv[0]);
+        return 1;
+    }
+
+    int job_count = rom_count * copies;
+    Job *jobs = calloc(job_count, sizeof(Job));
+    f.workers = aligned_alloc(_Alignof(Worker), threads * sizeof(Worker));
+    if (jobs == NULL || f.workers == NULL) {
+        perror("failed to allocate the farm");
+        return 2;
+    }
+    // every board in one mapping
+    BoardPool pool;
+    if (!board_pool_init(&pool, job_count, huge)) {
+        return 2;
+    }
+    if (huge && !pool.huge) {
+        fprintf(stderr, "no huge pages, the boards are on normal pages\n");
+    }
+    for (int i = 0; i < job_count; i++) {
+        jobs[i].rom = roms[i % rom_count];
+        jobs[i].b = board_pool_take(&pool, jobs[i].rom);
+        if (jobs[i].b == NULL || !board_set_engine(jobs[i].b, engine)) {
+            fprintf(stderr, "failed to init board for %s\n", jobs[i].rom);
+            return 2;
+        }
+        clock_set_turbo(&jobs[i].b->clk, true);
+    }
+
+    // boards dealt round robin, stealing evens out the rest
+    f.worker_count = threads;
+    atomic_init(&f.remaining, job_count);
+    for (int i = 0; i < threads; i++) {
+        Worker *w = &f.workers[i];
+        *w = (Worker){.farm = &f, .seed = i + 1};
+        pthread_mutex_init(&w->deque.lock, NULL);
+        w->deque.capacity = job_count;
+        w->deque.jobs = malloc(job_count * sizeof(Job *));
+        if (w->deque.jobs == NULL) {
+            perror("failed to allocate the farm");
+            return 2;
+        }
+    }
+    for (int i = 0; i < job_count; i++) {
+        deque_push(&f.workers[i % threads].deque, &jobs[i]);
+    }
+
+    double start = seconds();
+    for (int i = 0; i < threads; i++) {
+        pthread_create(&f.workers[i].thread, NULL, farm_worker, &f.workers[i]);
+    }
+    uint64_t quanta = 0;
+    uint64_t steals = 0;
+    for (int i = 0; i < threads; i++) {
+        pthread_join(f.workers[i].thread, NULL);
+        quanta += f.workers[i].quanta;
+        steals += f.workers[i].steals;
+    }
+    double elapsed = seconds() - start;
+
+    uint64_t cycles = 0;
+    int halted = 0;
+    for (int i = 0; i < job_count; i++) {
+        Board *b = jobs[i].b;
+        cycles += jobs[i].ran;
+        halted += b->c->halted;
+        if (verbose) {
+            printf("%-24s %-16s PC=$%04X %llu cycles\n", jobs[i].rom, farm_status(b), b->c->PC,
+                   (unsigned long long)jobs[i].ran);
+        }
+        board_shutdown(b);
+    }
+    printf("%d boards (%d halted) on %d threads, %llu quanta, %llu steals\n", job_count, halted, threads,
+           (unsigned long long)quanta, (unsigned long long)steals);
+    printf("%.2f emulated MHz in total, %.2f s\n", cycles / elapsed / 1e6, elapsed);
+
+    for (int i = 0; i < threads; i++) {
+        pthread_mutex_destroy(&f.workers[i].deque.lock);
+        free(f.workers[i].deque.jobs);
+    }
+    board_pool_shutdown(&pool);
+    free(f.workers);
+    free(jobs);
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "./board.h"
+
+// Indexed by DecodedOp.mode
+static const struct {
+    byte (*mode)(cpu *c);
+    byte length;
+} modes[] = {
+    [MODE_IMP] = {IMP, 1}, [MODE_ACC] = {ACC, 1}, [MODE_IMM] = {IMM, 2},
+    [MODE_ZPG] = {ZPG, 2}, [MODE_ZPX] = {ZPX, 2}, [MODE_ZPY] = {ZPY, 2},
+    [MODE_ABS] = {ABS, 3}, [MODE_ABX] = {ABX, 3}, [MODE_ABY] = {ABY, 3},
+    [MODE_IND] = {IND, 3}, [MODE_IZY] = {IZY, 2}, [MODE_IZX] = {IZX, 2},
+    [MODE_REL] = {REL, 2},
+#ifdef CPU_VARIANT_65C02
+    [MODE_ZPI] = {ZPI, 2}, [MODE_IAX] = {IAX, 3},
+#endif // CPU_VARIANT_65C02
+};
+
+ICache *icache_init(void) {
+    ICache *ic = (ICache *)calloc(1, sizeof(ICache));
+    return ic;
+}
+
+void icache_shutdown(ICache *ic) {
+    free(ic);
+}
+
+void icache_reset(ICache *ic) {
+    memset(ic, 0, sizeof(*ic));
+}
+
+void icache_invalidate_page(ICache *ic, byte page) {
+    // a page covers MEM_PAGE_SIZE consecutive lines, plus the two before it
+    // for instructions whose operand runs into the page
+    word start = (page << MEM_PAGE_SHIFT) - 2;
+    for (unsigned i = 0; i < MEM_PAGE_SIZE + 2; i++) {
+        word pc = start + i;
+        DecodedOp *op = &ic->lines[pc & (ICACHE_LINES - 1)];
+        byte first = op->pc >> MEM_PAGE_SHIFT;
+        byte last = (word)(op->pc + op->length - 1) >> MEM_PAGE_SHIFT;
+        if (op->valid && op->pc == pc && (first == page || last == page)) {
+            op->valid = false;
+        }
+    }
+}
+
+// Only decodes from plain memory: device reads may have side effects and
+// their content can change behind our back
+bool icache_decode(Board *b, word pc, DecodedOp *op) {
+    if (b->pages[pc >> MEM_PAGE_SHIFT].read == NULL) {
+        return false;
+    }
+    const struct code_t *code = &cpu_code_table[board_read(b, pc)];
+
+    byte mode = 0;
+    while (modes[mode].mode != code->addressing_mode) {
+        mode++;
+    }
+    byte length = modes[mode].length;
+    word last = pc + length - 1;
+    if (b->pages[last >> MEM_PAGE_SHIFT].read == NULL) {
+        return false;
+    }
+    if (board_page_direct(b, pc >> MEM_PAGE_SHIFT) || board_page_direct(b, last >> MEM_PAGE_SHIFT)) {
+        // written around the watch, see board_write_zp()
+        return false;
+    }
+
+    op->mode = mode;
+    op->pc = pc;
+    op->IR = board_read(b, pc);
+    op->length = length;
+    op->cycles = code->cycles;
+    if (code->addressing_mode == &IMM) {
+        op->operand = pc + 1;
+    } else if (length == 2) {
+        op->operand = board_read(b, pc + 1);
+    } else if (length == 3) {
+        op->operand = board_read(b, pc + 1) | (board_read(b, (word)(pc + 2)) << 8);
+    } else {
+        op->operand = 0;
+    }
+    op->valid = true;
+
+    // RAM resident code: the next write to these pages drops the line
+    board_watch_page(b, pc >> MEM_PAGE_SHIFT);
+    board_watch_page(b, last >> MEM_PAGE_SHIFT);
+    return true;
+}
+
+static inline byte icache_run(cpu *c, const DecodedOp *op) {
+    c->IR = op->IR;
+    c->PC += op->length;
+    return cpu_step_decoded(c, op->operand);
+}
+
+// Kept out of line so the hit path stays a leaf with no spills
+__attribute__((noinline)) static byte icache_miss(cpu *c, DecodedOp *op) {
+    c->bc->icache->misses++;
+    if (!icache_decode(c->bc, c->PC, op)) {
+        return cpu_step(c);
+    }
+    return icache_run(c, op);
+}
+
+byte icache_step(cpu *c) {
+    ICache *ic = c->bc->icache;
+    DecodedOp *op = &ic->lines[c->PC & (ICACHE_LINES - 1)];
+
+    if (c->nmi == TIED_LOW || c->irq == TIED_LOW) {
+        byte cycles = cpu_interrupt(c);
+        if (cycles != 0) {
+            return cycles;
+        }
+    }
+    if (!op->valid || op->pc != c->PC) {
+        return icache_miss(c, op);
+    }
+    ic->hits++;
+    return icache_run(c, op);
+}
@@ -0,0 +1,53 @@
+#ifndef ICACHE_H_
+#define ICACHE_H_
+
+#include "./arch.h"
+
+// Direct-mapped, one line per instruction start address (PC)
+#define ICACHE_LINES 0x1000
+
+typedef struct Board Board;
+typedef struct cpu cpu;
+
+// Addressing modes, resolved from the operand fetched at decode time
+enum {
+    MODE_IMP, MODE_ACC, MODE_IMM, MODE_ZPG, MODE_ZPX, MODE_ZPY, MODE_ABS,
+    MODE_ABX, MODE_ABY, MODE_IND, MODE_IZY, MODE_IZX, MODE_REL,
+#ifdef CPU_VARIANT_65C02
+    MODE_ZPI, MODE_IAX,
+#endif // CPU_VARIANT_65C02
+};
+
+// A decoded instruction: everything cpu_step() would fetch and look up
+typedef struct DecodedOp {
+    word pc;        // tag, address of the opcode
+    word operand;   // raw operand bytes, or the immediate's address
+    byte mode;      // MODE_*
+    byte IR;
+    byte length;    // opcode + operand bytes
+    byte cycles;    // base cycles
+    bool valid;
+} DecodedOp;
+
+typedef struct ICache {
+    DecodedOp lines[ICACHE_LINES];
+    uint64_t hits;
+    uint64_t misses;
+} ICache;
+
+ICache *icache_init(void);
+void icache_shutdown(ICache *ic);
+// Drops every decoded instruction and clears the counters
+void icache_reset(ICache *ic);
+
+// Decodes the instruction at pc into op and watches the pages it was read
+// from, false if it does not come from plain memory
+bool icache_decode(Board *b, word pc, DecodedOp *op);
+
+// Drops every decoded instruction with a byte in the given 256-byte page
+void icache_invalidate_page(ICache *ic, byte page);
+
+// Same contract as cpu_step(), through c->bc's instruction cache
+byte icache_step(cpu *c);
+
+#endif // !ICACHE_H_
@@ -0,0 +1,123 @@
+#include <string.h>
+
+#include "./board.h"
+
+void idle_init(Idle *idle) {
+    idle->enabled = true;
+    idle->loops = 0;
+    idle->skipped = 0;
+    memset(idle->reject, 0, sizeof(idle->reject));
+}
+
+void idle_invalidate_page(Idle *idle, byte page) {
+    memset(&idle->reject[page * (MEM_PAGE_SIZE / 8)], 0, MEM_PAGE_SIZE / 8);
+}
+
+static bool idle_rejected(const Idle *idle, word pc) {
+    return idle->reject[pc >> 3] & (1 << (pc & 7));
+}
+
+static void idle_reject(Idle *idle, word pc) {
+    idle->reject[pc >> 3] |= 1 << (pc & 7);
+}
+
+// Instructions that only touch registers and flags, which a settled loop
+// sets to the same values every time round. Memory operands must be plain
+// reads, checked when the loop runs.
+static byte idle_length(const struct code_t *code) {
+    byte (*mode)(cpu *) = code->addressing_mode;
+    byte (*op)(cpu *) = code->opcode;
+
+    if (op != &LDA && op != &LDX && op != &LDY && op != &BIT
+        && op != &CMP && op != &CPX && op != &CPY && op != &AND && op != &ORA
+        && op != &NOP && op != &CLC && op != &SEC && op != &CLV && op != &CLD
+        && op != &SED && op != &TAX && op != &TAY && op != &TXA && op != &TYA) {
+        return 0;
+    }
+    if (mode == &IMP) {
+        return 1;
+    }
+    if (mode == &IMM || mode == &ZPG || mode == &ZPX || mode == &ZPY) {
+        return 2;
+    }
+    if (mode == &ABS || mode == &ABX || mode == &ABY) {
+        return 3;
+    }
+    return 0;
+}
+
+// The instruction at pc can be part of an idle loop and comes whole from
+// plain memory
+static bool idle_allowed(Board *b, word pc) {
+    if (b->pages[pc >> MEM_PAGE_SHIFT].read == NULL) {
+        return false;
+    }
+    byte IR = board_read(b, pc);
+    const struct code_t *code = &cpu_code_table[IR];
+    byte length;
+    if (code->addressing_mode == &REL) {
+        length = 2;
+    } else if (IR == 0x4C) {
+        // JMP abs
+        length = 3;
+    } else {
+        length = idle_length(code);
+    }
+    return length != 0 && b->pages[(word)(pc + length - 1) >> MEM_PAGE_SHIFT].read != NULL;
+}
+
+static bool idle_same(const cpu *a, const cpu *b) {
+    return a->A == b->A && a->X == b->X && a->Y == b->Y && a->SP == b->SP
+        && cpu_get_P(a) == cpu_get_P(b) && a->IR == b->IR && a->address_bus == b->address_bus
+        && a->address_relative == b->address_relative && a->data_bus == b->data_bus
+        && a->nmi == b->nmi && a->irq == b->irq && a->reset == b->reset;
+}
+
+uint64_t idle_skip(Board *b, uint64_t now, uint64_t stop) {
+    Idle *idle = &b->idle;
+    cpu *c = b->c;
+    word head = c->PC;
+
+    // a pending interrupt ends the wait, and the probe below must fit
+    if (c->nmi == TIED_LOW || (c->irq == TIED_LOW && !(c->P & FLAG_I))
+        || now + IDLE_MAX_CYCLES >= stop || idle_rejected(idle, head)) {
+        return now;
+    }
+
+    // Run one time round on the interpreter. With no stores on the way and
+    // only plain memory read, a round that comes back to head with the CPU
+    // as it left repeats exactly until something outside the CPU steps in.
+    cpu before = *c;
+    uint64_t period = 0;
+    for (int n = 0; n < IDLE_MAX_OPS; n++) {
+        if (!idle_allowed(b, c->PC)) {
+            idle_reject(idle, head);
+            return now + period;
+        }
+        period += cpu_step(c);
+        if (c->PC == b->break_pc) {
+            // the breakpoint is in the loop, stop there
+            b->stop = true;
+            return now + period;
+        }
+        if (b->pages[c->address_bus >> MEM_PAGE_SHIFT].read == NULL) {
+            // polls a device, which may change what it reads
+            idle_reject(idle, head);
+            return now + period;
+        }
+        if (c->PC == head) {
+            break;
+        }
+    }
+    now += period;
+    if (c->PC != head || !idle_same(&before, c)) {
+        // too long a loop, or not settled yet and the next time round may be
+        return now;
+    }
+
+    // whole rounds only, the remainder runs normally
+    uint64_t skipped = (stop - now) / period * period;
+    idle->loops++;
+    idle->skipped += skipped;
+    return now + skipped;
+}
@@ -0,0 +1,35 @@
+#ifndef IDLE_H_
+#define IDLE_H_
+
+#include "./arch.h"
+#include "./cpu.h"
+
+typedef struct Board Board;
+
+// Longest loop body considered, in instructions
+#define IDLE_MAX_OPS 8
+
+// Upper bound on the cycles of one such loop iteration
+#define IDLE_MAX_CYCLES (IDLE_MAX_OPS * 8)
+
+typedef struct Idle {
+    bool enabled;
+    uint64_t loops;     // fast-forwards taken
+    uint64_t skipped;   // cycles fast-forwarded
+    byte reject[0x10000 / 8];  // loop heads found not to be idle, one bit each
+} Idle;
+
+void idle_init(Idle *idle);
+
+// Forgets what was learnt about the loops of the given 256-byte page
+void idle_invalidate_page(Idle *idle, byte page);
+
+// Called when a step ended at or before the address it started from. If
+// c->PC is on a side-effect-free spin loop (a branch or JMP to itself, or a
+// few loads and compares polling plain memory) that has settled, skips as
+// many whole iterations as fit before `stop` (the next event or clock sync)
+// and returns the new cycle count.
+// The CPU ends in the state the skipped iterations would have left it in.
+uint64_t idle_skip(Board *b, uint64_t now, uint64_t stop);
+
+#endif // !IDLE_H_
@@ -0,0 +1,12 @@
+#include "./board.h"
+
+// Default board: 32KB internal RAM at $0000, the 32KB PRG-ROM window at
+// $8000 is filled by board_load_rom().
+// A console would mirror a smaller RAM and hang its devices here, e.g.
+//   { .kind = REGION_RAM, .start = 0x0000, .size = 0x0800 },
+//   { .kind = REGION_MIRROR, .start = 0x0800, .size = 0x1800, .source = 0x0000, .source_size = 0x0800 },
+//   { .kind = REGION_DEVICE, .start = 0x2000, .size = 0x0100, .read = ppu_read, .write = ppu_write, .device = &ppu },
+const Region board_default_layout[] = {
+    { .kind = REGION_RAM, .start = ZERO_PAGE, .size = RAM_SIZE },
+    { .kind = REGION_END },
+};
@@ -2,8 +2,27 @@
 #include <stdlib.h>
 #include <time.h>
 #include <ctype.h>
+#include <string.h>
+#include <pthread.h>
+#include <signal.h>
 
 #include "./board.h"
+#include "./display.h"
+
+// The reset button of the interactive emulator: kill -USR1 <pid>. SIGUSR1
+// is blocked in every thread and taken here with sigwait(), so the board is
+// never touched from a signal handler.
+static void *reset_button(void *arg) {
+    Board *b = arg;
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGUSR1);
+    int sig;
+    while (sigwait(&set, &sig) == 0) {
+        board_signal_reset(b);
+    }
+    return NULL;
+}
 
 int parse_arguments(char response) {
     if(response == 'y' || response == 'Y') {
@@ -14,9 +33,172 @@ int parse_arguments(char response) {
     return 0;
 } 
 
+// Exit codes of --headless runs, 1 and 2 are bad arguments and startup
+// failures like everywhere else
+#define EXIT_DONE 0
+#define EXIT_JAM 3
+#define EXIT_ACCESS_VIOLATION 4
+#define EXIT_TIMEOUT 5
+#define EXIT_ILLEGAL_OPCODE 6
+
+// Cycles per board_run_cycles() call when only an --until condition ends
+// the run
+#define HEADLESS_SLICE (1ULL << 30)
+
+static double seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+// --headless: runs as fast as the host allows until `cycles` have run (0
+// for no limit) or an --until condition (-1 for none) is met, then prints
+// the final state as one line of JSON
+static int run_headless(Board *b, uint64_t cycles, int32_t until_pc, int32_t until_write) {
+    cpu *c = b->c;
+    clock_set_turbo(&b->clk, true);
+    board_break_pc(b, until_pc);
+    board_break_write(b, until_write);
+    bool until = until_pc >= 0 || until_write >= 0;
+
+    const char *status = NULL;
+    int code = EXIT_DONE;
+    uint64_t ran = 0;
+    double start = seconds();
+    while (status == NULL) {
+        if (c->PC == until_pc) {
+            status = "until-pc";
+        } else if (cycles != 0 && ran >= cycles) {
+            // the budget is the timeout of an --until run
+            status = until ? "timeout" : "done";
+            code = until ? EXIT_TIMEOUT : EXIT_DONE;
+        } else {
+            ran += board_run_cycles(b, cycles != 0 ? cycles - ran : HEADLESS_SLICE);
+            if (b->fault == ACCESS_VIOLATION) {
+                status = "access-violation";
+                code = EXIT_ACCESS_VIOLATION;
+            } else if (b->fault == ILLEGAL_OPCODE) {
+                status = "illegal-opcode";
+                code = EXIT_ILLEGAL_OPCODE;
+            } else if (c->halted) {
+                status = "jam";
+                code = EXIT_JAM;
+            } else if (b->stop && c->PC != until_pc) {
+                status = "until-write";
+            }
+        }
+    }
+    double elapsed = seconds() - start;
+
+    printf("{\"status\": \"%s\", \"pc\": %u, \"ir\": %u, \"a\": %u, \"x\": %u, \"y\": %u, "
+           "\"sp\": %u, \"p\": %u, \"cycles\": %llu, \"seconds\": %.6f, \"mhz\": %.3f",
+           status, c->PC, c->IR, c->A, c->X, c->Y, c->SP, cpu_get_P(c),
+           (unsigned long long)ran, elapsed, elapsed > 0 ? ran / elapsed / 1e6 : 0.0);
+    if (b->fault != 0) {
+        printf(", \"fault_address\": %u", b->fault_address);
+    }
+    printf("}\n");
+    return code;
+}
+
+// FILE@ADDR[:SIZE], the window runs to the end of memory by default
+static bool load_image(Board *b, const char *spec) {
+    char path[4096];
+    unsigned int base = 0, size = 0;
+    const char *at = strrchr(spec, '@');
+    if (at == NULL || (size_t)(at - spec) >= sizeof(path)
+        || sscanf(at + 1, "%x:%x", &base, &size) < 1 || base > 0xFFFF) {
+        fprintf(stderr, "bad ROM image %s, expected FILE@ADDR[:SIZE]\n", spec);
+        return false;
+    }
+    memcpy(path, spec, at - spec);
+    path[at - spec] = '\0';
+    if (size == 0) {
+        size = 0x10000 - base;
+    }
+    return board_load_rom(b, path, base, size, true);
+}
+
 int main(int argc, char **argv) {
     Board *b = NULL;
-    if(argc < 2) {
+    const char *rom_path = NULL;
+    bool turbo = false;
+    double speed = 1.0;
+    Engine engine = ENGINE_INTERP;
+    bool verify = false;
+    bool idle = true;
+    // extra images, --rom FILE@ADDR[:SIZE]
+    const char *images[BOARD_MAX_ROMS];
+    int image_count = 0;
+    bool headless = false;
+    uint64_t cycles = 0;
+    int32_t until_pc = -1;
+    int32_t until_write = -1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--turbo") == 0) {
+            turbo = true;
+        } else if (strcmp(argv[i], "--rom") == 0 && i + 1 < argc) {
+            if (image_count == BOARD_MAX_ROMS - 1) {
+                fprintf(stderr, "too many ROM images\n");
+                return 1;
+            }
+            images[image_count++] = argv[++i];
+        } else if (strcmp(argv[i], "--engine") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "interp") == 0) {
+                engine = ENGINE_INTERP;
+            } else if (strcmp(argv[i], "icache") == 0) {
+                engine = ENGINE_ICACHE;
+            } else if (strcmp(argv[i], "block") == 0) {
+                engine = ENGINE_BLOCK;
+            } else if (strcmp(argv[i], "dynarec") == 0) {
+                engine = ENGINE_DYNAREC;
+            } else if (strcmp(argv[i], "aot") == 0) {
+                engine = ENGINE_AOT;
+            } else if (strcmp(argv[i], "batch") == 0) {
+                engine = ENGINE_BATCH;
+            } else {
+                fprintf(stderr, "unknown engine %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--verify") == 0) {
+            verify = true;
+        } else if (strcmp(argv[i], "--no-idle-skip") == 0) {
+            idle = false;
+        } else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            speed = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--headless") == 0) {
+            headless = true;
+        } else if (strcmp(argv[i], "--cycles") == 0 && i + 1 < argc) {
+            cycles = strtoull(argv[++i], NULL, 0);
+        } else if ((strcmp(argv[i], "--until-pc") == 0 || strcmp(argv[i], "--until-write") == 0)
+                   && i + 1 < argc) {
+            // hex like --rom
+            unsigned int address;
+            if (sscanf(argv[i + 1], "%x", &address) != 1 || address > 0xFFFF) {
+                fprintf(stderr, "bad address %s for %s\n", argv[i + 1], argv[i]);
+                return 1;
+            }
+            if (strcmp(argv[i++], "--until-pc") == 0) {
+                until_pc = address;
+            } else {
+                until_write = address;
+            }
+        } else {
+            rom_path = argv[i];
+        }
+    }
+
+    if (headless && cycles == 0 && until_pc < 0 && until_write < 0) {
+        fprintf(stderr, "--headless needs --cycles, --until-pc or --until-write\n");
+        return 1;
+    }
+
+    if (rom_path == NULL && headless) {
+        // nobody to ask
+        b = board_init(NULL);
+    } else if(rom_path == NULL) {
         char response = 0;
         int result = 0;
         fprintf(stderr, "No ROM file loaded!\nSystem will proceed with the default reset.bin ROM\n");
@@ -30,7 +212,7 @@ int main(int argc, char **argv) {
             return 1;
         } 
     } else {
-        b = board_init(argv[1]);
+        b = board_init(rom_path);
     }
     
     if (b == NULL) {
@@ -38,13 +220,86 @@ int main(int argc, char **argv) {
         return 2;
     }
 
+    for (int i = 0; i < image_count; i++) {
+        if (!load_image(b, images[i])) {
+            board_shutdown(b);
+            return 2;
+        }
+    }
+    if (image_count > 0) {
+        // the vectors may live in one of the extra images
+        cpu_reset(b->c);
+    }
+
+    if (!board_set_engine(b, engine)
+        || (verify && (b->dynarec == NULL || !dynarec_set_verify(b->dynarec, true)))) {
+        printf("failed to set engine\n");
+        board_shutdown(b);
+        return 2;
+    }
+    clock_set_speed(&b->clk, speed);
+    clock_set_turbo(&b->clk, turbo);
+    b->idle.enabled = idle;
+
+    if (headless) {
+        int code = run_headless(b, cycles, until_pc, until_write);
+        board_shutdown(b);
+        return code;
+    }
+
+    // blocked before any thread starts, they all inherit it
+    sigset_t usr1;
+    sigemptyset(&usr1);
+    sigaddset(&usr1, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &usr1, NULL);
+    pthread_t button;
+    if (pthread_create(&button, NULL, reset_button, b) != 0) {
+        printf("failed to start the reset button\n");
+        board_shutdown(b);
+        return 2;
+    }
+
+    // this thread emulates, the status screen is drawn from another one
+    Display display;
+    if (!display_start(&display, b)) {
+        printf("failed to start display\n");
+        pthread_cancel(button);
+        pthread_join(button, NULL);
+        board_shutdown(b);
+        return 2;
+    }
+
+    // publish about as often as the screen is redrawn at normal speed
+    uint64_t frame = b->clk.frequency / DISPLAY_HZ;
     bool power = true;
     while (power) {
-        __run(b);
-        debug_print_CPU(b->c);
-        system("clear");
+        board_run_cycles(b, frame);
+        display_publish(&display, b);
+        if (b->fault != 0) {
+            // the emulator used to stop right there, it still does
+            display_stop(&display);
+            if (b->fault == ACCESS_VIOLATION) {
+                fprintf(stderr, "access violation at $%04X\n", b->fault_address);
+            } else {
+                fprintf(stderr, "illegal opcode $%02X at $%04X\n", b->c->IR, b->fault_address);
+            }
+            int fault = b->fault;
+            pthread_cancel(button);
+            pthread_join(button, NULL);
+            board_shutdown(b);
+            return fault;
+        }
+        if (b->c->halted) {
+            // sleeps until the reset button is pressed
+            board_wait_reset(b);
+        } else {
+            board_poll_reset(b);
+        }
     }
 
+    display_stop(&display);
+    pthread_cancel(button);
+    pthread_join(button, NULL);
     board_shutdown(b);
     
     return 0;
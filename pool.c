@@ -0,0 +1,83 @@
+#include <stdio.h>
+#include <sys/mman.h>
+
+#include "./pool.h"
+
+bool board_pool_init(BoardPool *pool, unsigned capacity, bool huge_pages) {
+    size_t size = (size_t)capacity * sizeof(Board);
+    pool->arena = MAP_FAILED;
+    pool->huge = false;
+    if (huge_pages) {
+        size = (size + POOL_HUGE_PAGE - 1) / POOL_HUGE_PAGE * POOL_HUGE_PAGE;
+        pool->arena = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        pool->huge = pool->arena != MAP_FAILED;
+    }
+    if (pool->arena == MAP_FAILED) {
+        pool->arena = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+    if (pool->arena == MAP_FAILED) {
+        perror("failed to map the board pool");
+        return false;
+    }
+#ifdef MADV_HUGEPAGE
+    if (huge_pages && !pool->huge) {
+        // no huge pages reserved, let the kernel back it with transparent ones
+        pool->huge = madvise(pool->arena, size, MADV_HUGEPAGE) == 0;
+    }
+#endif // MADV_HUGEPAGE
+    pool->size = size;
+    pool->capacity = capacity;
+    pool->used = 0;
+    pool->free = NULL;
+    pthread_mutex_init(&pool->lock, NULL);
+    return true;
+}
+
+void board_pool_shutdown(BoardPool *pool) {
+    // the engines every slot kept from its boards
+    for (unsigned i = 0; i < pool->used; i++) {
+        board_free_engines((Board *)pool->arena + i);
+    }
+    munmap(pool->arena, pool->size);
+    pthread_mutex_destroy(&pool->lock);
+}
+
+// A slot handed back before, else the next fresh one. Slots are page (or
+// huge page) aligned plus multiples of sizeof(Board), so cache line aligned.
+static Board *board_pool_slot(BoardPool *pool) {
+    pthread_mutex_lock(&pool->lock);
+    Board *b = pool->free;
+    if (b != NULL) {
+        pool->free = b->pool_next;
+    } else if (pool->used < pool->capacity) {
+        b = (Board *)pool->arena + pool->used++;
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return b;
+}
+
+Board *board_pool_take_layout(BoardPool *pool, const Region *layout) {
+    Board *b = board_pool_slot(pool);
+    if (b == NULL) {
+        fprintf(stderr, "board pool exhausted (%u boards)\n", pool->capacity);
+        return NULL;
+    }
+    b->pool = pool;
+    if (!board_setup(b, layout)) {
+        board_pool_give(pool, b);
+        return NULL;
+    }
+    return b;
+}
+
+Board *board_pool_take(BoardPool *pool, const char *rom_path) {
+    return board_init_rom(board_pool_take_layout(pool, board_default_layout), rom_path);
+}
+
+void board_pool_give(BoardPool *pool, Board *b) {
+    pthread_mutex_lock(&pool->lock);
+    b->pool_next = pool->free;
+    pool->free = b;
+    pthread_mutex_unlock(&pool->lock);
+}
@@ -0,0 +1,41 @@
+#ifndef POOL_H_
+#define POOL_H_
+
+#include <pthread.h>
+#include <stddef.h>
+
+#include "./board.h"
+
+// Huge page size tried for pool arenas
+#define POOL_HUGE_PAGE (2u << 20)
+
+// Boards carved out of one mapping, each in a cache line aligned slot with
+// its cpu and memory inline. board_shutdown() hands a pooled board back
+// with its engines emptied but still allocated, and the next
+// board_pool_take() resets it in place and board_set_engine() reuses them.
+typedef struct BoardPool {
+    pthread_mutex_t lock;
+    byte *arena;
+    size_t size;        // bytes mapped
+    unsigned capacity;  // slots
+    unsigned used;      // slots handed out at least once
+    Board *free;        // slots handed back, linked through pool_next
+    bool huge;          // backed by huge pages
+} BoardPool;
+
+// Maps room for `capacity` boards. With huge_pages it asks for explicit huge
+// pages first, then transparent ones, see pool->huge for what it got.
+bool board_pool_init(BoardPool *pool, unsigned capacity, bool huge_pages);
+// All boards taken must have been shut down. Frees the engines the slots
+// kept for their next board.
+void board_pool_shutdown(BoardPool *pool);
+
+// board_init() and board_init_layout() on a slot of the pool, NULL if they
+// fail or the pool is exhausted
+Board *board_pool_take(BoardPool *pool, const char *rom_path);
+Board *board_pool_take_layout(BoardPool *pool, const Region *layout);
+
+// Called by board_shutdown()
+void board_pool_give(BoardPool *pool, Board *b);
+
+#endif // !POOL_H_
@@ -0,0 +1,275 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "./board.h"
+
+// Superinstruction profiler: runs ROMs on the interpreter and records the
+// instructions executed, cut into the blocks the block engine would decode.
+// Every window of two or three instructions inside a block, with all but
+// the last fusable (see block_fusable()), is a candidate. Winners are picked
+// one at a time: the block_fuse() matching of those picked so far is played
+// over the trace, and the candidate saving the most dispatches among the
+// instructions still left over wins the next round. The winners are written
+// as fused.def, rebuild afterwards to compile their handlers into cpu.c.
+
+// Instructions run per ROM
+#define PROFILE_INSTRUCTIONS 10000000L
+// Superinstructions written out
+#define PROFILE_MAX_FUSED 16
+// Sequences saving fewer dispatches than this share of the instructions run
+// are left out
+#define PROFILE_MIN_SHARE 0.001
+
+#define PROFILE_SLOTS 0x10000
+
+typedef struct Sequence {
+    uint32_t key;       // length in the top byte then the opcodes, 0 if free
+    uint64_t runs;
+} Sequence;
+
+// One instruction run from plain memory
+typedef struct Traced {
+    byte IR;
+    bool starts;        // first of its block
+    bool fused;         // taken by a winner picked already
+} Traced;
+
+static Sequence counts[PROFILE_SLOTS];
+static Sequence winners[PROFILE_MAX_FUSED];
+static int winner_count;
+static Traced *trace;
+static long traced;
+static uint64_t executed;
+static bool fusable[0x100];
+
+static byte profile_length(const Sequence *s) {
+    return s->key >> 24;
+}
+
+static byte profile_opcode(const Sequence *s, byte i) {
+    return s->key >> (8 * (profile_length(s) - 1 - i));
+}
+
+// Open addressing, a full table drops new sequences
+static void profile_count(const Traced *ops, byte n) {
+    uint32_t key = n << 24;
+    for (byte i = 0; i < n; i++) {
+        key |= ops[i].IR << (8 * (n - 1 - i));
+    }
+    uint32_t slot = (key * 2654435761u) >> 16;
+    for (int probe = 0; probe < PROFILE_SLOTS; probe++) {
+        Sequence *s = &counts[(slot + probe) & (PROFILE_SLOTS - 1)];
+        if (s->key == key) {
+            s->runs++;
+            return;
+        }
+        if (s->key == 0) {
+            *s = (Sequence){key, 1};
+            return;
+        }
+    }
+}
+
+static int profile_rom(const char *rom_path, long instructions) {
+    Board *b = board_init(rom_path);
+    if (b == NULL) {
+        fprintf(stderr, "failed to init board for %s\n", rom_path);
+        return 1;
+    }
+    cpu *c = b->c;
+
+    // a block starts after a break in the flow, after an instruction that
+    // ends one, and every BLOCK_MAX_OPS instructions
+    bool starts = true;
+    int length = 0;
+    word next_pc = 0;
+    for (long i = 0; i < instructions; i++) {
+        DecodedOp op;
+        word pc = c->PC;
+        if (!icache_decode(b, pc, &op)) {
+            // not plain memory, the block engine runs it on its own
+            starts = true;
+        } else {
+            if (pc != next_pc || length == BLOCK_MAX_OPS) {
+                // taken branch, jump or interrupt, or a full block
+                starts = true;
+            }
+            length = starts ? 1 : length + 1;
+            trace[traced++] = (Traced){op.IR, starts, false};
+            starts = block_ends(op.IR);
+            next_pc = pc + op.length;
+        }
+        cpu_step(c);
+        executed++;
+    }
+    board_shutdown(b);
+    return 0;
+}
+
+// Winner matching at trace[i], as block_fuse() would
+static bool profile_matches(long i, const Sequence *s) {
+    byte n = profile_length(s);
+    if (i + n > traced) {
+        return false;
+    }
+    for (byte k = 0; k < n; k++) {
+        const Traced *t = &trace[i + k];
+        if (t->IR != profile_opcode(s, k) || (k != 0 && t->starts) || (k != n - 1 && !fusable[t->IR])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Marks what the winners take: left to right in each block, longest first
+static void profile_tile(void) {
+    for (long i = 0; i < traced; ) {
+        byte best = 0;
+        for (int w = 0; w < winner_count; w++) {
+            byte n = profile_length(&winners[w]);
+            if (n > best && profile_matches(i, &winners[w])) {
+                best = n;
+            }
+        }
+        if (best == 0) {
+            trace[i++].fused = false;
+            continue;
+        }
+        for (byte k = 0; k < best; k++) {
+            trace[i++].fused = true;
+        }
+    }
+}
+
+// Counts the windows of two and three instructions among those left over
+static void profile_windows(void) {
+    memset(counts, 0, sizeof(counts));
+    for (long i = 0; i < traced; i++) {
+        for (byte n = 1; n <= 3 && n <= i + 1; n++) {
+            const Traced *t = &trace[i - n + 1];
+            if (t->fused || (n > 1 && !fusable[t->IR])) {
+                break;
+            }
+            if (n > 1) {
+                profile_count(t, n);
+            }
+            if (t->starts) {
+                break;
+            }
+        }
+    }
+}
+
+static uint64_t profile_saved(const Sequence *s) {
+    return s->runs * (profile_length(s) - 1);
+}
+
+// The candidate saving the most dispatches, false if none saves enough. On
+// a tie one ending its block wins: it leaves the rest of the block in one
+// piece for the next rounds.
+static bool profile_pick(Sequence *winner) {
+    const Sequence *best = NULL;
+    for (int i = 0; i < PROFILE_SLOTS; i++) {
+        const Sequence *s = &counts[i];
+        if (s->key == 0) {
+            continue;
+        }
+        if (best == NULL || profile_saved(s) > profile_saved(best)
+            || (profile_saved(s) == profile_saved(best)
+                && block_ends(profile_opcode(s, profile_length(s) - 1))
+                > block_ends(profile_opcode(best, profile_length(best) - 1)))) {
+            best = s;
+        }
+    }
+    if (best == NULL || (double)profile_saved(best) / executed < PROFILE_MIN_SHARE) {
+        return false;
+    }
+    *winner = *best;
+    return true;
+}
+
+static void profile_emit(FILE *out, int argc, char **argv, long instructions) {
+    fprintf(out, "// fused.def\n");
+    fprintf(out, "// Superinstructions for the block engine, FUSE2(a, b) and FUSE3(a, b, c) run\n");
+    fprintf(out, "// those opcodes back to back in one handler (see cpu.c). Generated by the\n");
+    fprintf(out, "// profiler from %ld instructions of", instructions);
+    for (int i = 0; i < argc; i++) {
+        fprintf(out, " %s", argv[i]);
+    }
+    fprintf(out, ",\n// regenerate with make fuse.\n");
+    fprintf(out, "// No include guard on purpose, define FUSE2 and FUSE3 before each inclusion.\n\n");
+
+    for (int i = 0; i < winner_count; i++) {
+        const Sequence *s = &winners[i];
+        byte n = profile_length(s);
+        fprintf(out, "FUSE%u(", n);
+        for (byte k = 0; k < n; k++) {
+            fprintf(out, k == 0 ? "0x%02X" : ", 0x%02X", profile_opcode(s, k));
+        }
+        fprintf(out, ") //");
+        for (byte k = 0; k < n; k++) {
+            fprintf(out, " %s", cpu_code_table[profile_opcode(s, k)].str);
+        }
+        fprintf(out, ", %.1f%% of instructions\n", 100.0 * s->runs * n / executed);
+    }
+    fprintf(stderr, "%d superinstructions from %llu instructions\n", winner_count,
+            (unsigned long long)executed);
+}
+
+int main(int argc, char **argv) {
+    const char *out_path = NULL;
+    long instructions = PROFILE_INSTRUCTIONS;
+    // ROM paths, gathered at the front of argv
+    char **roms = argv + 1;
+    int rom_count = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            instructions = atol(argv[++i]);
+        } else {
+            roms[rom_count++] = argv[i];
+        }
+    }
+    if (rom_count == 0) {
+        fprintf(stderr, "usage: %s ROM... [-n INSTRUCTIONS] [-o fused.def]\n", argv[0]);
+        return 1;
+    }
+
+    trace = malloc((size_t)rom_count * instructions * sizeof(Traced));
+    if (trace == NULL) {
+        perror("failed to allocate the trace");
+        return 2;
+    }
+    for (int i = 0; i < rom_count; i++) {
+        if (profile_rom(roms[i], instructions) != 0) {
+            return 2;
+        }
+    }
+    for (int op = 0; op < 0x100; op++) {
+        fusable[op] = block_fusable(op);
+    }
+    // the picks so far change what is left over for the next one
+    while (winner_count < PROFILE_MAX_FUSED) {
+        profile_tile();
+        profile_windows();
+        if (!profile_pick(&winners[winner_count])) {
+            break;
+        }
+        winner_count++;
+    }
+    free(trace);
+
+    FILE *out = out_path != NULL ? fopen(out_path, "w") : stdout;
+    if (out == NULL) {
+        perror("Error opening output");
+        return 1;
+    }
+    profile_emit(out, rom_count, roms, instructions);
+    if (out != stdout) {
+        fclose(out);
+    }
+    return 0;
+}
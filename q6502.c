@@ -0,0 +1,111 @@
+#include "./board.h"
+#include "./debug_tools.h"
+#include "./q6502.h"
+
+q6502_board *q6502_open(const char *rom_path) {
+    Board *b = board_init(rom_path);
+    if (b != NULL) {
+        clock_set_turbo(&b->clk, true);
+    }
+    return b;
+}
+
+void q6502_close(q6502_board *b) {
+    board_shutdown(b);
+}
+
+bool q6502_set_engine(q6502_board *b, q6502_engine engine) {
+    return board_set_engine(b, (Engine)engine);
+}
+
+void q6502_set_turbo(q6502_board *b, bool turbo) {
+    clock_set_turbo(&b->clk, turbo);
+}
+
+static q6502_status q6502_board_status(const Board *b) {
+    if (b->fault == ACCESS_VIOLATION) {
+        return Q6502_ACCESS_VIOLATION;
+    }
+    if (b->fault == ILLEGAL_OPCODE) {
+        return Q6502_ILLEGAL_OPCODE;
+    }
+    if (b->c->halted) {
+        return Q6502_JAM;
+    }
+    return b->stop ? Q6502_BREAK : Q6502_OK;
+}
+
+q6502_status q6502_run(q6502_board *b, uint64_t budget, uint64_t *ran) {
+    uint64_t cycles = board_run_cycles(b, budget);
+    if (ran != NULL) {
+        *ran = cycles;
+    }
+    return q6502_board_status(b);
+}
+
+void q6502_reset(q6502_board *b) {
+    b->fault = 0;
+    cpu_reset(b->c);
+}
+
+void q6502_break_pc(q6502_board *b, int32_t pc) {
+    board_break_pc(b, pc);
+}
+
+bool q6502_break_write(q6502_board *b, int32_t address) {
+    return board_break_write(b, address);
+}
+
+void q6502_set_irq(q6502_board *b, bool asserted) {
+    b->c->irq = asserted ? TIED_LOW : TIED_HIGH;
+}
+
+void q6502_nmi(q6502_board *b) {
+    b->c->nmi = TIED_LOW;
+}
+
+void q6502_get_regs(const q6502_board *b, q6502_regs *regs) {
+    const cpu *c = b->c;
+    *regs = (q6502_regs){
+        .pc = c->PC, .a = c->A, .x = c->X, .y = c->Y, .sp = c->SP,
+        .p = cpu_get_P(c), .ir = c->IR,
+    };
+}
+
+uint64_t q6502_cycles(const q6502_board *b) {
+    return b->clk.cycles;
+}
+
+uint16_t q6502_fault_address(const q6502_board *b) {
+    return b->fault_address;
+}
+
+uint8_t q6502_peek(q6502_board *b, uint16_t address) {
+    return board_read(b, address);
+}
+
+bool q6502_poke(q6502_board *b, uint16_t address, uint8_t data) {
+    const Page *p = &b->pages[address >> MEM_PAGE_SHIFT];
+    if (p->write == NULL && p->watch == NULL) {
+        return false;
+    }
+    // a watched page drops the code cached from it on the way
+    board_write(b, address, data);
+    return true;
+}
+
+const char *q6502_status_name(q6502_status status) {
+    switch (status) {
+    case Q6502_OK:
+        return "ok";
+    case Q6502_BREAK:
+        return "break";
+    case Q6502_JAM:
+        return "jam";
+    case Q6502_ACCESS_VIOLATION:
+        return "access-violation";
+    case Q6502_ILLEGAL_OPCODE:
+        return "illegal-opcode";
+    }
+    return "unknown";
+}
@@ -0,0 +1,81 @@
+#ifndef Q6502_H_
+#define Q6502_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// libq6502, the emulator as a library (make lib). Boards share nothing, so
+// a process can run as many as it likes, each from one thread at a time.
+// Nothing in the library exits the process or traps: a fault halts that
+// board and comes back as the status of the run.
+
+#define Q6502_API __attribute__((visibility("default")))
+
+typedef struct Board q6502_board;
+
+typedef enum q6502_status {
+    Q6502_OK,               // the whole budget ran
+    Q6502_BREAK,            // stopped by q6502_break_pc() or q6502_break_write()
+    Q6502_JAM,              // the CPU executed JAM, halted until q6502_reset()
+    Q6502_ACCESS_VIOLATION, // write to ROM or unmapped memory, see q6502_fault_address()
+    Q6502_ILLEGAL_OPCODE,   // undocumented opcode, built with make ILLEGAL=trap
+} q6502_status;
+
+// Same engines as --engine, see the README
+typedef enum q6502_engine {
+    Q6502_ENGINE_INTERP,
+    Q6502_ENGINE_ICACHE,
+    Q6502_ENGINE_BLOCK,
+    Q6502_ENGINE_DYNAREC,
+    Q6502_ENGINE_AOT,
+    Q6502_ENGINE_BATCH,
+} q6502_engine;
+
+typedef struct q6502_regs {
+    uint16_t pc;
+    uint8_t a, x, y, sp, p;
+    uint8_t ir;     // opcode of the last instruction
+} q6502_regs;
+
+// Default board with the image at rom_path mirrored over $8000-$FFFF, reset
+// and running unthrottled. NULL if the image cannot be mapped.
+Q6502_API q6502_board *q6502_open(const char *rom_path);
+Q6502_API void q6502_close(q6502_board *b);
+
+Q6502_API bool q6502_set_engine(q6502_board *b, q6502_engine engine);
+// Throttles runs to the 6502's clock when false, the default is true
+Q6502_API void q6502_set_turbo(q6502_board *b, bool turbo);
+
+// Runs `budget` cycles, or less if the run breaks or the CPU halts. The
+// cycles actually run go to *ran if it is not NULL. A halted board runs
+// nothing and keeps returning its status until q6502_reset().
+Q6502_API q6502_status q6502_run(q6502_board *b, uint64_t budget, uint64_t *ran);
+// Resets the CPU and clears a fault, memory is kept
+Q6502_API void q6502_reset(q6502_board *b);
+
+// Stops runs when PC reaches `pc`, -1 for none
+Q6502_API void q6502_break_pc(q6502_board *b, int32_t pc);
+// Stops runs after the instruction writing `address`, -1 for none. False
+// if it is out of range.
+Q6502_API bool q6502_break_write(q6502_board *b, int32_t address);
+
+// Holds the IRQ line asserted until released
+Q6502_API void q6502_set_irq(q6502_board *b, bool asserted);
+// Raises an NMI, taken before the next instruction
+Q6502_API void q6502_nmi(q6502_board *b);
+
+Q6502_API void q6502_get_regs(const q6502_board *b, q6502_regs *regs);
+// Cycles run since q6502_open()
+Q6502_API uint64_t q6502_cycles(const q6502_board *b);
+// Address of the last Q6502_ACCESS_VIOLATION or Q6502_ILLEGAL_OPCODE
+Q6502_API uint16_t q6502_fault_address(const q6502_board *b);
+
+// Reads memory as the CPU would, devices included
+Q6502_API uint8_t q6502_peek(q6502_board *b, uint16_t address);
+// Writes RAM, false for ROM, devices and unmapped memory
+Q6502_API bool q6502_poke(q6502_board *b, uint16_t address, uint8_t data);
+
+// "ok", "break", "jam", "access-violation" or "illegal-opcode"
+Q6502_API const char *q6502_status_name(q6502_status status);
+
+#endif // !Q6502_H_
@@ -0,0 +1,302 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "./board.h"
+
+// Ahead-of-time recompiler: walks the code reachable from the NMI, RESET and
+// IRQ vectors of a ROM and writes it out as C, one function per entry point
+// (vector or JSR target). Each function holds the basic blocks first reached
+// from its entry, calls the cpu_exec_0xNN() handlers the interpreter runs,
+// and chains its own blocks with goto. Link the output with make AOT=file.c
+// and run it with --engine aot.
+
+#define RECOMP_MAX_FUNCTIONS 4096
+
+typedef struct Function {
+    word entry;
+    const char *vector;     // vector name, NULL for JSR targets
+} Function;
+
+static Board *b;
+
+static int owner[0x10000];      // function that traced the instruction, -1 if none
+static bool leader[0x10000];    // a block starts here
+
+static Function functions[RECOMP_MAX_FUNCTIONS];
+static int function_count;
+
+// pending block starts of the function being traced
+static word worklist[0x10000];
+static int worklist_count;
+
+// Only ROM is recompiled, anything writable may change under the code
+static bool recomp_is_rom(word pc) {
+    const Page *p = &b->pages[pc >> MEM_PAGE_SHIFT];
+    return p->read != NULL && p->write == NULL && p->watch == NULL;
+}
+
+// Decodes the instruction at pc if it lies entirely in ROM
+static bool recomp_decode(word pc, DecodedOp *op) {
+    if (!recomp_is_rom(pc) || !icache_decode(b, pc, op)) {
+        return false;
+    }
+    return recomp_is_rom((word)(pc + op->length - 1));
+}
+
+static bool recomp_is_ending(byte IR) {
+    const struct code_t *code = &cpu_code_table[IR];
+    return code->addressing_mode == &REL
+        || code->opcode == &JMP || code->opcode == &JSR
+        || code->opcode == &RTS || code->opcode == &RTI
+        || code->opcode == &BRK || code->opcode == &JAM;
+}
+
+static void recomp_add_leader(word pc) {
+    leader[pc] = true;
+    worklist[worklist_count++] = pc;
+}
+
+static void recomp_add_function(word entry, const char *vector) {
+    leader[entry] = true;
+    if (owner[entry] != -1) {
+        // already part of another function, enterable there
+        return;
+    }
+    for (int i = 0; i < function_count; i++) {
+        if (functions[i].entry == entry) {
+            return;
+        }
+    }
+    if (function_count == RECOMP_MAX_FUNCTIONS) {
+        fprintf(stderr, "too many functions, $%04X left to the interpreter\n", entry);
+        return;
+    }
+    functions[function_count++] = (Function){entry, vector};
+}
+
+// Follows the code from pc until control flow leaves it, queuing branch and
+// jump targets. JSR targets become new functions.
+static void recomp_trace(int f, word pc) {
+    DecodedOp op;
+    for (;;) {
+        if (owner[pc] != -1) {
+            leader[pc] = true;
+            return;
+        }
+        if (!recomp_decode(pc, &op)) {
+            return;
+        }
+        owner[pc] = f;
+
+        word next = pc + op.length;
+        const struct code_t *code = &cpu_code_table[op.IR];
+        if (code->addressing_mode == &REL) {
+            recomp_add_leader(next + (int8_t)op.operand);
+            recomp_add_leader(next);
+            return;
+        }
+        if (op.IR == 0x4C) {
+            // JMP abs
+            recomp_add_leader(op.operand);
+            return;
+        }
+        if (op.IR == 0x20) {
+            // JSR abs, RTS comes back to the next instruction
+            recomp_add_function(op.operand, NULL);
+            recomp_add_leader(next);
+            return;
+        }
+        if (recomp_is_ending(op.IR)) {
+            // JMP ind, RTS, RTI, BRK, JAM: resolved at run time
+            return;
+        }
+        pc = next;
+    }
+}
+
+static void recomp_walk(void) {
+    memset(owner, -1, sizeof(owner));
+    recomp_add_function(board_read(b, NMI) | (board_read(b, NMI + 1) << 8), "NMI");
+    recomp_add_function(board_read(b, RESET) | (board_read(b, RESET + 1) << 8), "RESET");
+    recomp_add_function(board_read(b, IRQ) | (board_read(b, IRQ + 1) << 8), "IRQ");
+
+    for (int f = 0; f < function_count; f++) {
+        worklist_count = 0;
+        worklist[worklist_count++] = functions[f].entry;
+        while (worklist_count > 0) {
+            recomp_trace(f, worklist[--worklist_count]);
+        }
+    }
+}
+
+// Block successor inside function f, or nothing
+static bool recomp_local(int f, word pc) {
+    return owner[pc] == f && leader[pc];
+}
+
+// Writes one block and returns the number of ROM bytes it covers
+static word recomp_emit_block(FILE *out, int f, word start, int *ops) {
+    DecodedOp op;
+    word pc = start;
+    int count = 0;
+
+    fprintf(out, "L_%04X:\n", start);
+    for (;;) {
+        if (count != 0) {
+            // a fault or write breakpoint stops the run right after the store
+            fprintf(out, "    if (c->bc->stop) { *ops += %d; return cycles; }\n", count);
+        }
+        recomp_decode(pc, &op);
+        word next = pc + op.length;
+        fprintf(out, "    c->IR = 0x%02X; c->PC = 0x%04X; cycles += cpu_exec_0x%02X(c, 0x%04X); // %s\n",
+                op.IR, next, op.IR, op.operand, cpu_code_table[op.IR].str);
+        count++;
+
+        if (recomp_is_ending(op.IR)) {
+            break;
+        }
+        if (leader[next] || owner[next] != f) {
+            break;
+        }
+        if (count == AOT_BLOCK_MAX_OPS) {
+            leader[next] = true;
+            break;
+        }
+        pc = next;
+    }
+    fprintf(out, "    *ops += %d;\n", count);
+    *ops += count;
+
+    // chain to the successors this function holds, within the step's cycles
+    word next = pc + op.length;
+    const struct code_t *code = &cpu_code_table[op.IR];
+    word targets[2];
+    int target_count = 0;
+    bool known = true;
+    if (code->addressing_mode == &REL) {
+        targets[target_count++] = next + (int8_t)op.operand;
+        targets[target_count++] = next;
+        known = false;
+    } else if (op.IR == 0x4C || op.IR == 0x20) {
+        targets[target_count++] = op.operand;
+    } else if (!recomp_is_ending(op.IR)) {
+        targets[target_count++] = next;
+    }
+
+    bool chained = false;
+    for (int i = 0; i < target_count; i++) {
+        if (!recomp_local(f, targets[i])) {
+            continue;
+        }
+        if (!chained) {
+            // a fault or breakpoint (b->stop) ends the step too
+            fprintf(out, "    if (cycles >= AOT_STEP_CYCLES || c->bc->stop) return cycles;\n");
+            chained = true;
+        }
+        if (known) {
+            fprintf(out, "    goto L_%04X;\n\n", targets[i]);
+            return next - start;
+        }
+        fprintf(out, "    if (c->PC == 0x%04X) goto L_%04X;\n", targets[i], targets[i]);
+    }
+    fprintf(out, "    return cycles;\n\n");
+    return next - start;
+}
+
+static void recomp_emit(FILE *out, const char *rom_path) {
+    static AotEntry entries[0x10000];
+    static int entry_function[0x10000];
+    unsigned entry_count = 0;
+    int ops = 0;
+
+    fprintf(out, "// Generated by recompiler from %s, do not edit\n\n", rom_path);
+    fprintf(out, "#include \"./board.h\"\n#include \"./cpu_exec.h\"\n\n");
+
+    for (int f = 0; f < function_count; f++) {
+        if (owner[functions[f].entry] != f) {
+            continue;
+        }
+        fprintf(out, "// $%04X%s%s\n", functions[f].entry,
+                functions[f].vector != NULL ? ", " : "",
+                functions[f].vector != NULL ? functions[f].vector : "");
+        fprintf(out, "static byte aot_%04X(cpu *c) {\n", functions[f].entry);
+        fprintf(out, "    uint64_t *ops = &c->bc->aot->ops;\n");
+        fprintf(out, "    unsigned cycles = 0;\n\n");
+
+        // blocks split at AOT_BLOCK_MAX_OPS add leaders ahead of pc, which
+        // the entry switch needs, so emit the blocks to a buffer first
+        char *body = NULL;
+        size_t body_size = 0;
+        FILE *blocks = open_memstream(&body, &body_size);
+        unsigned first = entry_count;
+        for (unsigned pc = 0; pc < 0x10000; pc++) {
+            if (owner[pc] == f && leader[pc]) {
+                entries[entry_count].pc = pc;
+                entries[entry_count].length = recomp_emit_block(blocks, f, pc, &ops);
+                entry_function[entry_count++] = f;
+            }
+        }
+        fclose(blocks);
+
+        fprintf(out, "    switch (c->PC) {\n");
+        for (unsigned i = first; i < entry_count; i++) {
+            fprintf(out, "    case 0x%04X: goto L_%04X;\n", entries[i].pc, entries[i].pc);
+        }
+        fprintf(out, "    default: return cpu_step(c);\n    }\n\n");
+        fputs(body, out);
+        fprintf(out, "}\n\n");
+        free(body);
+    }
+
+    fprintf(out, "const AotEntry aot_entries[] = {\n");
+    for (unsigned i = 0; i < entry_count; i++) {
+        fprintf(out, "    {0x%04X, %u, aot_%04X},\n", entries[i].pc, entries[i].length,
+                functions[entry_function[i]].entry);
+    }
+    fprintf(out, "};\n");
+    fprintf(out, "const unsigned aot_entry_count = %u;\n", entry_count);
+    fprintf(out, "const uint32_t aot_checksum = 0x%08Xu;\n", aot_hash(b, entries, entry_count));
+
+    fprintf(stderr, "%d functions, %u blocks, %d instructions\n", function_count, entry_count, ops);
+}
+
+int main(int argc, char **argv) {
+    const char *rom_path = NULL;
+    const char *out_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else {
+            rom_path = argv[i];
+        }
+    }
+    if (rom_path == NULL) {
+        fprintf(stderr, "usage: %s ROM [-o OUTPUT.c]\n", argv[0]);
+        return 1;
+    }
+
+    b = board_init(rom_path);
+    if (b == NULL) {
+        printf("failed to init board\n");
+        return 2;
+    }
+    FILE *out = out_path != NULL ? fopen(out_path, "w") : stdout;
+    if (out == NULL) {
+        perror("Error opening output");
+        board_shutdown(b);
+        return 1;
+    }
+
+    recomp_walk();
+    recomp_emit(out, rom_path);
+
+    if (out != stdout) {
+        fclose(out);
+    }
+    board_shutdown(b);
+    return 0;
+}
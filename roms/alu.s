@@ -0,0 +1,47 @@
+    .org $8000
+
+; ALU benchmark: arithmetic, logic, shifts and compares on registers and
+; zero page, most of whose flags are overwritten before anything reads them.
+reset:
+    ldx #$ff
+    txs
+    cli
+    lda #$35
+    sta $10
+    lda #$5a
+    sta $11
+
+main:
+    ldy #$00
+.inner:
+    tya
+    clc
+    adc $10
+    sbc #$13
+    eor $11
+    asl $17
+    rol $12
+    adc #$07
+    lsr $13
+    ror $18
+    and #$7f
+    ora $10
+    cmp #$40
+    cpx $11
+    sta $14
+    inc $15
+    dec $16
+    bit $11
+    tax
+    iny
+    bne .inner
+    jmp main
+
+nmi:
+irq:
+    rti
+
+    .org $FFFA
+    .word nmi
+    .word reset
+    .word irq
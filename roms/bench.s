@@ -0,0 +1,32 @@
+    .org $8000
+
+; Interpreter throughput benchmark: a tight read-only loop mixing
+; immediate, zero page and indexed absolute operands with a taken branch.
+reset:
+    ldx #$ff
+    txs
+    cli
+
+main:
+    ldx #$00
+.inner:
+    lda $8000,x
+    clc
+    adc #$01
+    and #$7f
+    eor $10
+    ora #$01
+    cmp #$40
+    tay
+    dex
+    bne .inner
+    jmp main
+
+nmi:
+irq:
+    rti
+
+    .org $FFFA
+    .word nmi
+    .word reset
+    .word irq
@@ -0,0 +1,90 @@
+#include "./sched.h"
+
+void sched_init(Scheduler *s) {
+    s->count = 0;
+    s->next_id = 1;
+    s->next = UINT64_MAX;
+    s->now = 0;
+    s->dispatched = 0;
+}
+
+static bool sched_before(const Event *a, const Event *b) {
+    return a->cycle < b->cycle || (a->cycle == b->cycle && a->id < b->id);
+}
+
+static void sched_swap(Scheduler *s, unsigned i, unsigned j) {
+    Event e = s->heap[i];
+    s->heap[i] = s->heap[j];
+    s->heap[j] = e;
+}
+
+static void sched_up(Scheduler *s, unsigned i) {
+    while (i > 0) {
+        unsigned parent = (i - 1) / 2;
+        if (!sched_before(&s->heap[i], &s->heap[parent])) {
+            break;
+        }
+        sched_swap(s, i, parent);
+        i = parent;
+    }
+}
+
+static void sched_down(Scheduler *s, unsigned i) {
+    for (;;) {
+        unsigned least = i;
+        unsigned left = 2 * i + 1;
+        unsigned right = left + 1;
+        if (left < s->count && sched_before(&s->heap[left], &s->heap[least])) {
+            least = left;
+        }
+        if (right < s->count && sched_before(&s->heap[right], &s->heap[least])) {
+            least = right;
+        }
+        if (least == i) {
+            break;
+        }
+        sched_swap(s, i, least);
+        i = least;
+    }
+}
+
+// Removes heap slot i, keeping the heap ordered
+static void sched_remove(Scheduler *s, unsigned i) {
+    s->heap[i] = s->heap[--s->count];
+    if (i < s->count) {
+        sched_down(s, i);
+        sched_up(s, i);
+    }
+    s->next = s->count > 0 ? s->heap[0].cycle : UINT64_MAX;
+}
+
+uint64_t sched_add(Scheduler *s, uint64_t cycle, event_t fn, void *data) {
+    if (s->count == SCHED_MAX_EVENTS) {
+        return 0;
+    }
+    uint64_t id = s->next_id++;
+    unsigned i = s->count++;
+    s->heap[i] = (Event){cycle, id, fn, data};
+    sched_up(s, i);
+    s->next = s->heap[0].cycle;
+    return id;
+}
+
+bool sched_cancel(Scheduler *s, uint64_t id) {
+    for (unsigned i = 0; i < s->count; i++) {
+        if (s->heap[i].id == id) {
+            sched_remove(s, i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool sched_pop(Scheduler *s, uint64_t cycle, Event *e) {
+    if (s->count == 0 || s->heap[0].cycle > cycle) {
+        return false;
+    }
+    *e = s->heap[0];
+    sched_remove(s, 0);
+    return true;
+}
@@ -0,0 +1,40 @@
+#ifndef SCHED_H_
+#define SCHED_H_
+
+#include "./arch.h"
+
+typedef struct Board Board;
+
+// Pending events per board
+#define SCHED_MAX_EVENTS 64
+
+// Event callback, run at the first instruction boundary at or after `cycle`
+typedef void (*event_t)(Board *b, void *data, uint64_t cycle);
+
+typedef struct Event {
+    uint64_t cycle;     // absolute cycle count it is due at
+    uint64_t id;        // order of scheduling, breaks ties
+    event_t fn;
+    void *data;
+} Event;
+
+// Min-heap of events keyed by (cycle, id)
+typedef struct Scheduler {
+    Event heap[SCHED_MAX_EVENTS];
+    unsigned count;
+    uint64_t next_id;
+    uint64_t next;          // cycle of the earliest event, UINT64_MAX if none
+    uint64_t now;           // cycle the running instruction started at
+    uint64_t dispatched;    // events run
+} Scheduler;
+
+void sched_init(Scheduler *s);
+
+// Queues fn at `cycle` and returns an id for sched_cancel(), 0 if full
+uint64_t sched_add(Scheduler *s, uint64_t cycle, event_t fn, void *data);
+// Drops a pending event, false if it already ran or never existed
+bool sched_cancel(Scheduler *s, uint64_t id);
+// Removes the earliest event due at or before `cycle` into e, false if none
+bool sched_pop(Scheduler *s, uint64_t cycle, Event *e);
+
+#endif // !SCHED_H_